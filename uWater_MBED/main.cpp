@@ -72,6 +72,11 @@ MoistureResource moisture(&logger, "3304/0/5700", true); /* true for observable
 #include "RelayResource.h"
 RelayResource relay(&logger, "3201/0/5550", true); /* true for observable */
 
+// Batched reads: object-level (GET /3304/0) and endpoint-level (GET /state) in one SenML payload
+#include "CompositeResource.h"
+CompositeResource moisture_object(&logger, "3304/0");
+CompositeResource state(&logger, "state", true); /* true for observable: one notification per window for moisture + relay */
+
 // Set our own unique endpoint name
 #define MY_ENDPOINT_NAME                       "WateringBoard"
 
@@ -91,6 +96,11 @@ Connector::Options *configure_endpoint(Connector::OptionsBuilder &config)
     //slider.setMaxAge(0); /* MaxAge = 0 to disable caching of the slide value in the Device Server */
     moisture.setMaxAge(0);
     relay.setMaxAge(0);
+    moisture_object.addMember(&moisture);
+    moisture_object.setMaxAge(0);
+    state.addMember(&moisture);
+    state.addMember(&relay);
+    state.setMaxAge(0);
     return config.setEndpointNodename(MY_ENDPOINT_NAME)                   // custom endpoint name
                  .setNSPAddress(my_nsp_address)                           // custom NSP address
                  .setDomain(MY_NSP_DOMAIN)                                // custom NSP domain
@@ -104,8 +114,10 @@ Connector::Options *configure_endpoint(Connector::OptionsBuilder &config)
                  //.addResource(&light)
                  //.addResource(&slider, 10000)
                  .addResource(&led)
-                 .addResource(&moisture, 10000)
-                 .addResource(&relay)
+                 .addResource(&moisture, false)                           // observed through "state"
+                 .addResource(&relay, false)                              // observed through "state"
+                 .addResource(&moisture_object)
+                 .addResource(&state, 10000)                              // composite observation window (ms)
                    
                  // finalize the configuration...
                  .build();
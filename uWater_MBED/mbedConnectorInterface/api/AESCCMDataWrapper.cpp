@@ -0,0 +1,344 @@
+/**
+ * @file    AESCCMDataWrapper.cpp
+ * @brief   mbed CoAP Endpoint AES-CCM Data Wrapper class (implementation)
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AESCCMDataWrapper.h"
+
+// AES block size
+#define AES_BLOCK_LENGTH    16
+
+// CCM flag bytes for B0 (no AAD, M=8, L=2) and the A_i counter blocks (L=2)
+#define CCM_B0_FLAGS        ((((AES_CCM_TAG_LENGTH-2)/2)<<3)|(15-AES_CCM_NONCE_LENGTH-1))
+#define CCM_A_FLAGS         (15-AES_CCM_NONCE_LENGTH-1)
+
+#if defined(TARGET_K64F)
+    // mmCAU is on the K64F private peripheral bus
+    #define USE_MMCAU       1
+
+    // mmCAU command words: up to 3 commands per write to a CAU direct register
+    #define MMCAU_2_CMDS    0x80100000u
+    #define MMCAU_3_CMDS    0x80100200u
+
+    // mmCAU opcodes and register numbers
+    #define MMCAU_CA0       2
+    #define MMCAU_CA1       3
+    #define MMCAU_CA2       4
+    #define MMCAU_CA3       5
+    #define MMCAU_AESS      0x0a0
+    #define MMCAU_AESR      0x0e0
+
+    // SubBytes on CA0-CA3 followed by ShiftRows
+    #define MMCAU_SUBBYTES_CMD  (MMCAU_3_CMDS|((MMCAU_AESS+MMCAU_CA0)<<22)|((MMCAU_AESS+MMCAU_CA1)<<11)|(MMCAU_AESS+MMCAU_CA2))
+    #define MMCAU_SHIFTROWS_CMD (MMCAU_2_CMDS|((MMCAU_AESS+MMCAU_CA3)<<22)|(MMCAU_AESR<<11))
+#endif
+
+// AES forward S-box
+static const uint8_t aes_sbox[256] = {
+    0x63,0x7c,0x77,0x7b,0xf2,0x6b,0x6f,0xc5,0x30,0x01,0x67,0x2b,0xfe,0xd7,0xab,0x76,
+    0xca,0x82,0xc9,0x7d,0xfa,0x59,0x47,0xf0,0xad,0xd4,0xa2,0xaf,0x9c,0xa4,0x72,0xc0,
+    0xb7,0xfd,0x93,0x26,0x36,0x3f,0xf7,0xcc,0x34,0xa5,0xe5,0xf1,0x71,0xd8,0x31,0x15,
+    0x04,0xc7,0x23,0xc3,0x18,0x96,0x05,0x9a,0x07,0x12,0x80,0xe2,0xeb,0x27,0xb2,0x75,
+    0x09,0x83,0x2c,0x1a,0x1b,0x6e,0x5a,0xa0,0x52,0x3b,0xd6,0xb3,0x29,0xe3,0x2f,0x84,
+    0x53,0xd1,0x00,0xed,0x20,0xfc,0xb1,0x5b,0x6a,0xcb,0xbe,0x39,0x4a,0x4c,0x58,0xcf,
+    0xd0,0xef,0xaa,0xfb,0x43,0x4d,0x33,0x85,0x45,0xf9,0x02,0x7f,0x50,0x3c,0x9f,0xa8,
+    0x51,0xa3,0x40,0x8f,0x92,0x9d,0x38,0xf5,0xbc,0xb6,0xda,0x21,0x10,0xff,0xf3,0xd2,
+    0xcd,0x0c,0x13,0xec,0x5f,0x97,0x44,0x17,0xc4,0xa7,0x7e,0x3d,0x64,0x5d,0x19,0x73,
+    0x60,0x81,0x4f,0xdc,0x22,0x2a,0x90,0x88,0x46,0xee,0xb8,0x14,0xde,0x5e,0x0b,0xdb,
+    0xe0,0x32,0x3a,0x0a,0x49,0x06,0x24,0x5c,0xc2,0xd3,0xac,0x62,0x91,0x95,0xe4,0x79,
+    0xe7,0xc8,0x37,0x6d,0x8d,0xd5,0x4e,0xa9,0x6c,0x56,0xf4,0xea,0x65,0x7a,0xae,0x08,
+    0xba,0x78,0x25,0x2e,0x1c,0xa6,0xb4,0xc6,0xe8,0xdd,0x74,0x1f,0x4b,0xbd,0x8b,0x8a,
+    0x70,0x3e,0xb5,0x66,0x48,0x03,0xf6,0x0e,0x61,0x35,0x57,0xb9,0x86,0xc1,0x1d,0x9e,
+    0xe1,0xf8,0x98,0x11,0x69,0xd9,0x8e,0x94,0x9b,0x1e,0x87,0xe9,0xce,0x55,0x28,0xdf,
+    0x8c,0xa1,0x89,0x0d,0xbf,0xe6,0x42,0x68,0x41,0x99,0x2d,0x0f,0xb0,0x54,0xbb,0x16
+};
+
+// AES key schedule round constants
+static const uint8_t aes_rcon[10] = { 0x01,0x02,0x04,0x08,0x10,0x20,0x40,0x80,0x1b,0x36 };
+
+// big-endian word load/store (the key schedule and the mmCAU both use big-endian columns)
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store_be32(uint8_t *p,uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+// GF(2^8) multiply by x
+static inline uint8_t aes_xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+// software AES-128 block encryption (round keys as big-endian words)
+static void sw_aes_encrypt_block(const uint32_t *rk,uint8_t *block) {
+    uint8_t s[AES_BLOCK_LENGTH];
+    uint8_t t[AES_BLOCK_LENGTH];
+
+    // AddRoundKey(0)
+    for(int c=0; c<4; ++c) {
+        for(int r=0; r<4; ++r) s[c*4+r] = block[c*4+r] ^ (uint8_t)(rk[c] >> (24-8*r));
+    }
+
+    for(int round=1; round<=10; ++round) {
+        // SubBytes + ShiftRows
+        for(int c=0; c<4; ++c) {
+            for(int r=0; r<4; ++r) t[c*4+r] = aes_sbox[s[((c+r)&3)*4+r]];
+        }
+
+        // MixColumns (not in the final round) + AddRoundKey
+        for(int c=0; c<4; ++c) {
+            uint8_t *a = &t[c*4];
+            uint32_t k = rk[round*4+c];
+            if (round < 10) {
+                uint8_t all = a[0] ^ a[1] ^ a[2] ^ a[3];
+                uint8_t a0 = a[0];
+                s[c*4+0] = a[0] ^ all ^ aes_xtime(a[0] ^ a[1]);
+                s[c*4+1] = a[1] ^ all ^ aes_xtime(a[1] ^ a[2]);
+                s[c*4+2] = a[2] ^ all ^ aes_xtime(a[2] ^ a[3]);
+                s[c*4+3] = a[3] ^ all ^ aes_xtime(a[3] ^ a0);
+            }
+            else {
+                memcpy(&s[c*4],a,4);
+            }
+            for(int r=0; r<4; ++r) s[c*4+r] ^= (uint8_t)(k >> (24-8*r));
+        }
+    }
+
+    memcpy(block,s,AES_BLOCK_LENGTH);
+}
+
+#ifdef USE_MMCAU
+// mmCAU AES-128 block encryption (round keys as big-endian words)
+static void cau_aes_encrypt_block(const uint32_t *rk,uint8_t *block) {
+    // the mmCAU state is not saved on a context switch... keep each block atomic
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    // load the state with round key 0 applied
+    for(int i=0; i<4; ++i) CAU->LDR_CA[i] = load_be32(&block[i*4]) ^ rk[i];
+
+    // rounds 1-9: SubBytes, ShiftRows, then MixColumns+AddRoundKey in one AESC per column
+    for(int round=1; round<10; ++round) {
+        CAU->DIRECT[0] = MMCAU_SUBBYTES_CMD;
+        CAU->DIRECT[1] = MMCAU_SHIFTROWS_CMD;
+        for(int i=0; i<4; ++i) CAU->AESC_CA[i] = rk[round*4+i];
+    }
+
+    // final round: no MixColumns
+    CAU->DIRECT[0] = MMCAU_SUBBYTES_CMD;
+    CAU->DIRECT[1] = MMCAU_SHIFTROWS_CMD;
+    for(int i=0; i<4; ++i) CAU->XOR_CA[i] = rk[40+i];
+
+    // read out the state
+    for(int i=0; i<4; ++i) store_be32(&block[i*4],CAU->STR_CA[i]);
+
+    __set_PRIMASK(primask);
+}
+#endif
+
+// constructor
+AESCCMDataWrapper::AESCCMDataWrapper(uint8_t *data,int data_length) : DataWrapper(data,data_length) {
+    this->init();
+}
+
+// constructor (alloc)
+AESCCMDataWrapper::AESCCMDataWrapper(int data_length) : DataWrapper(data_length) {
+    this->init();
+}
+
+// destructor
+AESCCMDataWrapper::~AESCCMDataWrapper() {
+    memset(this->m_round_keys,0,sizeof(this->m_round_keys));
+}
+
+// initialize internals and the default nonce prefix
+void AESCCMDataWrapper::init() {
+    uint8_t prefix[AES_CCM_NONCE_PREFIX_LEN];
+    uint32_t boot_random = 0;
+
+    memset(this->m_round_keys,0,sizeof(this->m_round_keys));
+    memset(this->m_nonce,0,AES_CCM_NONCE_LENGTH);
+    this->m_counter = 0;
+    this->m_keyed = false;
+    this->m_use_hardware = true;
+
+#if defined(TARGET_K64F)
+    // unique ID (low 40 bits) and a RNGA sample so nonces never repeat across reboots
+    SIM->SCGC6 |= SIM_SCGC6_RNGA_MASK;
+    RNG->CR |= RNG_CR_GO_MASK;
+    while((RNG->SR & RNG_SR_OREG_LVL_MASK) == 0);
+    boot_random = RNG->OR;
+    store_be32(&prefix[0],SIM->UIDL);
+    prefix[4] = (uint8_t)SIM->UIDML;
+#else
+    boot_random = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    store_be32(&prefix[0],((uint32_t)rand() << 16) ^ (uint32_t)rand());
+    prefix[4] = (uint8_t)rand();
+#endif
+    store_be32(&prefix[5],boot_random);
+    this->setNoncePrefix(prefix);
+}
+
+// set the nonce prefix
+void AESCCMDataWrapper::setNoncePrefix(const uint8_t *prefix) {
+    if (prefix != NULL) memcpy(this->m_nonce,prefix,AES_CCM_NONCE_PREFIX_LEN);
+}
+
+// set the app key (expand the AES-128 key schedule once)
+void AESCCMDataWrapper::setAppKey(uint8_t *appkey,int appkey_length) {
+    if (appkey == NULL || appkey_length != AES_CCM_KEY_LENGTH) {
+        std::printf("AESCCMDataWrapper: invalid key length %d (need %d)\r\n",appkey_length,AES_CCM_KEY_LENGTH);
+        return;
+    }
+
+    uint32_t *w = this->m_round_keys;
+    for(int i=0; i<4; ++i) w[i] = load_be32(&appkey[i*4]);
+    for(int i=4; i<44; ++i) {
+        uint32_t t = w[i-1];
+        if ((i % 4) == 0) {
+            t = (t << 8) | (t >> 24);
+            t = ((uint32_t)aes_sbox[(t >> 24) & 0xff] << 24) | ((uint32_t)aes_sbox[(t >> 16) & 0xff] << 16) |
+                ((uint32_t)aes_sbox[(t >> 8) & 0xff] << 8) | (uint32_t)aes_sbox[t & 0xff];
+            t ^= (uint32_t)aes_rcon[(i/4)-1] << 24;
+        }
+        w[i] = w[i-4] ^ t;
+    }
+    this->m_keyed = true;
+}
+
+// are we using the mmCAU?
+bool AESCCMDataWrapper::usingHardware() {
+#ifdef USE_MMCAU
+    return this->m_use_hardware;
+#else
+    return false;
+#endif
+}
+
+// encrypt one block in place
+void AESCCMDataWrapper::encryptBlock(uint8_t *block) {
+#ifdef USE_MMCAU
+    if (this->m_use_hardware) {
+        cau_aes_encrypt_block(this->m_round_keys,block);
+        return;
+    }
+#endif
+    sw_aes_encrypt_block(this->m_round_keys,block);
+}
+
+// CBC-MAC over B0 and the (zero padded) payload
+void AESCCMDataWrapper::computeTag(const uint8_t *nonce,const uint8_t *payload,int payload_length,uint8_t *tag) {
+    uint8_t x[AES_BLOCK_LENGTH];
+
+    x[0] = CCM_B0_FLAGS;
+    memcpy(&x[1],nonce,AES_CCM_NONCE_LENGTH);
+    x[14] = (uint8_t)(payload_length >> 8);
+    x[15] = (uint8_t)payload_length;
+    this->encryptBlock(x);
+
+    for(int offset=0; offset<payload_length; offset+=AES_BLOCK_LENGTH) {
+        int n = payload_length - offset;
+        if (n > AES_BLOCK_LENGTH) n = AES_BLOCK_LENGTH;
+        for(int i=0; i<n; ++i) x[i] ^= payload[offset+i];
+        this->encryptBlock(x);
+    }
+
+    memcpy(tag,x,AES_CCM_TAG_LENGTH);
+}
+
+// CTR mode: S_0 masks the tag, S_1..S_n encrypt/decrypt the payload (in place)
+void AESCCMDataWrapper::applyKeystream(const uint8_t *nonce,uint8_t *payload,int payload_length,uint8_t *tag) {
+    uint8_t a[AES_BLOCK_LENGTH];
+    uint8_t s[AES_BLOCK_LENGTH];
+    uint16_t counter = 0;
+
+    a[0] = CCM_A_FLAGS;
+    memcpy(&a[1],nonce,AES_CCM_NONCE_LENGTH);
+
+    for(int offset=-AES_BLOCK_LENGTH; offset<payload_length; offset+=AES_BLOCK_LENGTH) {
+        a[14] = (uint8_t)(counter >> 8);
+        a[15] = (uint8_t)counter;
+        memcpy(s,a,AES_BLOCK_LENGTH);
+        this->encryptBlock(s);
+        if (offset < 0) {
+            for(int i=0; i<AES_CCM_TAG_LENGTH; ++i) tag[i] ^= s[i];
+        }
+        else {
+            int n = payload_length - offset;
+            if (n > AES_BLOCK_LENGTH) n = AES_BLOCK_LENGTH;
+            for(int i=0; i<n; ++i) payload[offset+i] ^= s[i];
+        }
+        ++counter;
+    }
+}
+
+// wrap: nonce | ciphertext | MIC
+void AESCCMDataWrapper::wrap(uint8_t *data,int data_length) {
+    this->reset();
+    if (!this->m_keyed || data == NULL || data_length <= 0) return;
+
+    int length = data_length;
+    if (length > this->m_data_length_max - AES_CCM_OVERHEAD) length = this->m_data_length_max - AES_CCM_OVERHEAD;
+    if (length <= 0) return;
+
+    // next nonce
+    store_be32(&this->m_nonce[AES_CCM_NONCE_PREFIX_LEN],this->m_counter++);
+
+    uint8_t *nonce = this->m_data;
+    uint8_t *payload = this->m_data + AES_CCM_NONCE_LENGTH;
+    uint8_t *tag = payload + length;
+    memcpy(nonce,this->m_nonce,AES_CCM_NONCE_LENGTH);
+    memcpy(payload,data,length);
+
+    this->computeTag(nonce,payload,length,tag);
+    this->applyKeystream(nonce,payload,length,tag);
+    this->m_data_length = length + AES_CCM_OVERHEAD;
+}
+
+// unwrap: verify MIC and decrypt (leaves a NULL terminated plaintext in the buffer)
+void AESCCMDataWrapper::unwrap(uint8_t *data,int data_length) {
+    uint8_t nonce[AES_CCM_NONCE_LENGTH];
+    uint8_t received_tag[AES_CCM_TAG_LENGTH];
+    uint8_t computed_tag[AES_CCM_TAG_LENGTH];
+
+    this->reset();
+    if (!this->m_keyed || data == NULL || data_length < AES_CCM_OVERHEAD) return;
+
+    // we need room for a NULL terminator after the plaintext
+    int length = data_length - AES_CCM_OVERHEAD;
+    if (length >= this->m_data_length_max) return;
+
+    memcpy(nonce,data,AES_CCM_NONCE_LENGTH);
+    memcpy(received_tag,data + AES_CCM_NONCE_LENGTH + length,AES_CCM_TAG_LENGTH);
+    memmove(this->m_data,data + AES_CCM_NONCE_LENGTH,length);
+
+    this->applyKeystream(nonce,this->m_data,length,received_tag);
+    this->computeTag(nonce,this->m_data,length,computed_tag);
+
+    // constant time compare
+    uint8_t diff = 0;
+    for(int i=0; i<AES_CCM_TAG_LENGTH; ++i) diff |= received_tag[i] ^ computed_tag[i];
+    if (diff != 0) {
+        this->reset();
+        return;
+    }
+    this->m_data_length = length;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file    AESCCMDataWrapper.h
+ * @brief   mbed CoAP Endpoint AES-CCM Data Wrapper class (header)
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES_CCM_DATA_WRAPPER_H__
+#define __AES_CCM_DATA_WRAPPER_H__
+
+// Base class
+#include "DataWrapper.h"
+
+// AES-CCM parameters (RFC 3610: L=2, M=8)
+#define AES_CCM_KEY_LENGTH        16                                          // AES-128 only
+#define AES_CCM_NONCE_LENGTH      13                                          // 15 - L
+#define AES_CCM_NONCE_PREFIX_LEN  9                                           // fixed part of the nonce (the rest is the message counter)
+#define AES_CCM_TAG_LENGTH        8                                           // MIC length (M)
+#define AES_CCM_OVERHEAD          (AES_CCM_NONCE_LENGTH+AES_CCM_TAG_LENGTH)   // bytes added to each wrapped payload
+
+/**
+ AESCCMDataWrapper encrypts and authenticates payloads with AES-128-CCM.
+
+ Wrapped format: nonce (13 bytes) | ciphertext | MIC (8 bytes). The nonce is a
+ 9 byte per-boot prefix followed by a 32 bit message counter, so the receiver needs
+ no state beyond the shared key. On the K64F the block cipher runs on the mmCAU;
+ elsewhere (or when disabled with useHardware(false)) a table-based software AES is used.
+ All work is done in place in the wrapper buffer - no allocation per payload.
+ */
+class AESCCMDataWrapper : public DataWrapper {
+    public:
+        /**
+        Default constructor
+        @param data input the buffer to use for operations
+        @param data_length input the data length
+        */
+        AESCCMDataWrapper(uint8_t *data,int data_length);
+
+        /**
+        Default constructor (alloc)
+        @param data_length input the data length (alloc)
+        */
+        AESCCMDataWrapper(int data_length);
+
+        /**
+        Destructor
+        */
+        virtual ~AESCCMDataWrapper();
+
+        /**
+        Encrypt and authenticate the data
+        @param data input the data to wrap
+        @param data_length input the length of the data to wrap
+        */
+        virtual void wrap(uint8_t *data,int data_length);
+
+        /**
+        Authenticate and decrypt the data (length() is 0 if authentication fails)
+        @param data input the data to unwrap
+        @param data_length input the length of the data to unwrap
+        */
+        virtual void unwrap(uint8_t *data,int data_length);
+
+        /**
+        Set the new application key
+        @param appkey input the new AES-128 appkey
+        @param appkey_length input the appkey length (must be AES_CCM_KEY_LENGTH)
+        */
+        virtual void setAppKey(uint8_t *appkey,int appkey_length);
+
+        /**
+        Override the nonce prefix (default: chip unique ID and a per-boot random value)
+        @param prefix input the nonce prefix (AES_CCM_NONCE_PREFIX_LEN bytes)
+        */
+        void setNoncePrefix(const uint8_t *prefix);
+
+        /**
+        Select the mmCAU or the software block cipher (no effect without a mmCAU)
+        @param enable input true to use the mmCAU if present
+        */
+        void useHardware(bool enable) { this->m_use_hardware = enable; }
+
+        /**
+        Is the block cipher running on the mmCAU?
+        */
+        bool usingHardware();
+
+    private:
+        uint32_t m_round_keys[44];
+        uint8_t  m_nonce[AES_CCM_NONCE_LENGTH];
+        uint32_t m_counter;
+        bool     m_keyed;
+        bool     m_use_hardware;
+
+        // initialize internals
+        void init();
+
+        // encrypt a single block in place
+        void encryptBlock(uint8_t *block);
+
+        // CCM: CBC-MAC over the payload and CTR keystream application
+        void computeTag(const uint8_t *nonce,const uint8_t *payload,int payload_length,uint8_t *tag);
+        void applyKeystream(const uint8_t *nonce,uint8_t *payload,int payload_length,uint8_t *tag);
+};
+
+#endif // __AES_CCM_DATA_WRAPPER_H__
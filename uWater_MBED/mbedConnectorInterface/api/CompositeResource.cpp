@@ -0,0 +1,262 @@
+/**
+ * @file    CompositeResource.cpp
+ * @brief   mbed CoAP Endpoint object-level/composite (batched read) resource class (implementation)
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CompositeResource.h"
+
+// value fingerprints for change detection
+#include "HwCrc.h"
+
+// all members
+#define ALL_MEMBERS 0xFFFFFFFF
+
+// default constructor
+CompositeResource::CompositeResource(const Logger *logger,const char *name,const bool observable,const uint16_t content_format) : DynamicResource(logger,name,"Composite",SN_GRS_GET_ALLOWED,observable)
+{
+    this->setContentFormat(content_format);
+    this->m_num_members = 0;
+    this->m_same_object = true;
+    this->m_notified_mask = 0;
+    for(int i=0;i<COMPOSITE_MAX_MEMBERS;++i) {
+        this->m_members[i] = NULL;
+        this->m_member_crcs[i] = 0;
+    }
+}
+
+// destructor
+CompositeResource::~CompositeResource()
+{
+}
+
+// add a member
+bool CompositeResource::addMember(DynamicResource *resource)
+{
+    if (resource == NULL || this->m_num_members >= COMPOSITE_MAX_MEMBERS) {
+        this->logger()->log("CompositeResource: unable to add member to [%s] (max: %d)",this->getName().c_str(),COMPOSITE_MAX_MEMBERS);
+        return false;
+    }
+
+    // members below our own path keep the SenML base name and LWM2M TLV available
+    string prefix = this->getName() + "/";
+    string name = resource->getName();
+    if (name.compare(0,prefix.size(),prefix) != 0) this->m_same_object = false;
+
+    this->m_members[this->m_num_members] = resource;
+    this->m_member_names[this->m_num_members] = name;
+    ++this->m_num_members;
+    return true;
+}
+
+// text getter: SenML JSON
+string CompositeResource::get()
+{
+    uint8_t buffer[MAX_PAYLOAD_BUFFER_LENGTH];
+    int length = this->encodeSenMLJson(ALL_MEMBERS,buffer,MAX_PAYLOAD_BUFFER_LENGTH);
+    if (length < 0) return string("");
+    return string((char *)buffer,length);
+}
+
+// observe: one notification carrying every member changed within the window
+void CompositeResource::observe()
+{
+    if (this->m_observable == false) return;
+
+    uint16_t crcs[COMPOSITE_MAX_MEMBERS];
+    uint32_t changed = this->changedMembers(crcs);
+    if (changed == 0) return;
+
+    // SenML only (TLV cannot be carried in a libnsdl notification)
+    uint16_t content_format = this->getContentFormat();
+    if (content_format != CONTENT_FORMAT_SENML_CBOR) content_format = CONTENT_FORMAT_SENML_JSON;
+
+    uint8_t buffer[MAX_PAYLOAD_BUFFER_LENGTH];
+    int length = -1;
+    if (content_format == CONTENT_FORMAT_SENML_CBOR) length = this->encodeSenMLCbor(changed,buffer,MAX_PAYLOAD_BUFFER_LENGTH);
+    else length = this->encodeSenMLJson(changed,buffer,MAX_PAYLOAD_BUFFER_LENGTH);
+    if (length < 0) {
+        this->logger()->log("CompositeResource: unable to encode notification for [%s]",this->getName().c_str());
+        return;
+    }
+
+    // remember what the observers have seen only once it is sent
+    if (this->notify(buffer,length,content_format) != 0) {
+        for(int i=0;i<this->m_num_members;++i) {
+            if ((changed & (1 << i)) != 0) this->m_member_crcs[i] = crcs[i];
+        }
+        this->m_notified_mask |= changed;
+    }
+}
+
+// members changed since the last notification (compared on their SenML JSON value, so float values change at the text precision)
+uint32_t CompositeResource::changedMembers(uint16_t *crcs)
+{
+    uint32_t changed = 0;
+    uint8_t value[MAX_VALUE_BUFFER_LENGTH];
+    for(int i=0;i<this->m_num_members;++i) {
+        int length = this->m_members[i]->encodeMember(CONTENT_FORMAT_SENML_JSON,value,MAX_VALUE_BUFFER_LENGTH);
+        if (length < 0) continue;
+        crcs[i] = (uint16_t)HwCrc::compute(HwCrc::CRC16_CCITT,value,length);
+        if ((this->m_notified_mask & (1 << i)) == 0 || crcs[i] != this->m_member_crcs[i]) changed |= (1 << i);
+    }
+    return changed;
+}
+
+// encode all members
+int CompositeResource::encode(uint16_t content_format,uint8_t *buffer,int buffer_length)
+{
+    int length = -1;
+    switch(content_format) {
+        case CONTENT_FORMAT_SENML_JSON:
+            length = this->encodeSenMLJson(ALL_MEMBERS,buffer,buffer_length);
+            break;
+        case CONTENT_FORMAT_SENML_CBOR:
+            length = this->encodeSenMLCbor(ALL_MEMBERS,buffer,buffer_length);
+            break;
+        case CONTENT_FORMAT_LWM2M_TLV:
+            length = this->encodeTLV(buffer,buffer_length);
+            break;
+        default:
+            break;
+    }
+    if (length < 0) this->logger()->log("CompositeResource: unable to encode [%s] (content-format %d)",this->getName().c_str(),content_format);
+    return length;
+}
+
+// SenML JSON: [{"bn":"/3304/0/","n":"5700","v":0.53},...]
+int CompositeResource::encodeSenMLJson(uint32_t member_mask,uint8_t *buffer,int buffer_length)
+{
+    int prefix_length = this->m_same_object ? this->getName().size() + 1 : 0;
+    int pos = 0;
+    int n = 0;
+    bool first = true;
+
+    if (pos + 1 > buffer_length) return -1;
+    buffer[pos++] = '[';
+    for(int i=0;i<this->m_num_members;++i) {
+        if ((member_mask & (1 << i)) == 0) continue;
+        const string &name = this->m_member_names[i];
+
+        n = ValueCodec::literal(first ? "{" : ",{",buffer+pos,buffer_length-pos);
+        if (n < 0) return -1;
+        pos += n;
+
+        // base name on the first record only
+        if (first && this->m_same_object) {
+            string base_name = "/" + this->getName() + "/";
+            n = ValueCodec::literal("\"bn\":",buffer+pos,buffer_length-pos);
+            if (n < 0) return -1;
+            pos += n;
+            n = ValueCodec::jsonString(base_name.c_str(),base_name.size(),buffer+pos,buffer_length-pos);
+            if (n < 0 || pos + n + 1 > buffer_length) return -1;
+            pos += n;
+            buffer[pos++] = ',';
+        }
+
+        // name: relative to the base name, or absolute
+        n = ValueCodec::literal(this->m_same_object ? "\"n\":\"" : "\"n\":\"/",buffer+pos,buffer_length-pos);
+        if (n < 0) return -1;
+        pos += n;
+        n = ValueCodec::literal(name.c_str() + prefix_length,buffer+pos,buffer_length-pos);
+        if (n < 0) return -1;
+        pos += n;
+        n = ValueCodec::literal("\",",buffer+pos,buffer_length-pos);
+        if (n < 0) return -1;
+        pos += n;
+
+        // value
+        n = this->m_members[i]->encodeMember(CONTENT_FORMAT_SENML_JSON,buffer+pos,buffer_length-pos);
+        if (n < 0 || pos + n + 1 > buffer_length) return -1;
+        pos += n;
+        buffer[pos++] = '}';
+        first = false;
+    }
+    if (pos + 1 > buffer_length) return -1;
+    buffer[pos++] = ']';
+    return pos;
+}
+
+// SenML CBOR: [{-2:"/3304/0/",0:"5700",2:0.53},...]
+int CompositeResource::encodeSenMLCbor(uint32_t member_mask,uint8_t *buffer,int buffer_length)
+{
+    int prefix_length = this->m_same_object ? this->getName().size() + 1 : 0;
+    int pos = 0;
+    int n = 0;
+    int count = 0;
+    bool first = true;
+
+    for(int i=0;i<this->m_num_members;++i) {
+        if ((member_mask & (1 << i)) != 0) ++count;
+    }
+    n = ValueCodec::cborArray(count,buffer,buffer_length);
+    if (n < 0) return -1;
+    pos += n;
+    for(int i=0;i<this->m_num_members;++i) {
+        if ((member_mask & (1 << i)) == 0) continue;
+        const string &name = this->m_member_names[i];
+        bool with_base_name = (first && this->m_same_object);
+        first = false;
+
+        n = ValueCodec::cborMap(with_base_name ? 3 : 2,buffer+pos,buffer_length-pos);
+        if (n < 0) return -1;
+        pos += n;
+
+        if (with_base_name) {
+            string base_name = "/" + this->getName() + "/";
+            n = ValueCodec::cborInteger(SENML_LABEL_BASE_NAME,buffer+pos,buffer_length-pos);
+            if (n < 0) return -1;
+            pos += n;
+            n = ValueCodec::cborText(base_name.c_str(),base_name.size(),buffer+pos,buffer_length-pos);
+            if (n < 0) return -1;
+            pos += n;
+        }
+
+        n = ValueCodec::cborInteger(SENML_LABEL_NAME,buffer+pos,buffer_length-pos);
+        if (n < 0) return -1;
+        pos += n;
+        if (this->m_same_object) {
+            n = ValueCodec::cborText(name.c_str() + prefix_length,name.size() - prefix_length,buffer+pos,buffer_length-pos);
+        }
+        else {
+            string absolute = "/" + name;
+            n = ValueCodec::cborText(absolute.c_str(),absolute.size(),buffer+pos,buffer_length-pos);
+        }
+        if (n < 0) return -1;
+        pos += n;
+
+        n = this->m_members[i]->encodeMember(CONTENT_FORMAT_SENML_CBOR,buffer+pos,buffer_length-pos);
+        if (n < 0) return -1;
+        pos += n;
+    }
+    return pos;
+}
+
+// LWM2M TLV: the member resource TLVs back to back (object instance read)
+int CompositeResource::encodeTLV(uint8_t *buffer,int buffer_length)
+{
+    if (!this->m_same_object) return -1;
+    int pos = 0;
+    for(int i=0;i<this->m_num_members;++i) {
+        int n = this->m_members[i]->encodeMember(CONTENT_FORMAT_LWM2M_TLV,buffer+pos,buffer_length-pos);
+        if (n < 0) return -1;
+        pos += n;
+    }
+    return pos;
+}
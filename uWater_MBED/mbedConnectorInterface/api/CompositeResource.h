@@ -0,0 +1,102 @@
+/**
+ * @file    CompositeResource.h
+ * @brief   mbed CoAP Endpoint object-level/composite (batched read) resource class (header)
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COMPOSITE_RESOURCE_H__
+#define __COMPOSITE_RESOURCE_H__
+
+// Base class
+#include "DynamicResource.h"
+
+/** CompositeResource class
+
+ A read-only resource that answers a single GET with the values of several member
+ resources. Registered at an object instance path (e.g. "3304/0") it is the LWM2M
+ object-level read; registered at any other path (e.g. "state") it is an endpoint-level
+ composite read. Payloads are SenML JSON (default), SenML CBOR or - when every member
+ belongs to this object instance - LWM2M TLV, and are assembled directly from the
+ members' encodeMember() into the response buffer.
+
+ When observable, the composite is observed once per window (its observer period): the
+ members whose value changed since the last notification go out together in a single
+ SenML notification, and nothing is sent if none changed. Members observed this way
+ should be added to the endpoint without their own observer.
+ */
+class CompositeResource : public DynamicResource
+{
+public:
+    /**
+    Default constructor
+    @param logger input logger instance for this resource
+    @param name input the Resource URI/Name
+    @param observable input the resource is Observable (default: FALSE)
+    @param content_format input default content-format (default: SenML JSON)
+    */
+    CompositeResource(const Logger *logger,const char *name,const bool observable = false,const uint16_t content_format = CONTENT_FORMAT_SENML_JSON);
+
+    /**
+    Destructor
+    */
+    virtual ~CompositeResource();
+
+    /**
+    Add a member resource
+    @param resource input the member resource
+    @return true - added, false - table full
+    */
+    bool addMember(DynamicResource *resource);
+
+    /**
+    Number of member resources
+    */
+    int numMembers() { return this->m_num_members; }
+
+    /**
+    text getter: the SenML JSON representation
+    */
+    virtual string get();
+
+    /**
+    observe the composite: one SenML notification with the members changed since the last one
+    */
+    virtual void observe();
+
+protected:
+    // encode all members in the given content-format
+    virtual int encode(uint16_t content_format,uint8_t *buffer,int buffer_length);
+
+    // encode the SenML record array (selected members)/the TLV sequence
+    int encodeSenMLJson(uint32_t member_mask,uint8_t *buffer,int buffer_length);
+    int encodeSenMLCbor(uint32_t member_mask,uint8_t *buffer,int buffer_length);
+    int encodeTLV(uint8_t *buffer,int buffer_length);
+
+    // members whose value differs from the last notification (fingerprints returned in crcs)
+    uint32_t changedMembers(uint16_t *crcs);
+
+    DynamicResource *m_members[COMPOSITE_MAX_MEMBERS];
+    string           m_member_names[COMPOSITE_MAX_MEMBERS];
+    int              m_num_members;
+    bool             m_same_object;        // all members are below our own path (base name + relative names, TLV allowed)
+    uint16_t         m_member_crcs[COMPOSITE_MAX_MEMBERS];
+    uint32_t         m_notified_mask;      // members included in a notification at least once
+};
+
+#endif // __COMPOSITE_RESOURCE_H__
@@ -92,11 +92,11 @@ class DataWrapper {
         
     protected:
         uint8_t *m_data;
+        int      m_data_length;
+        int      m_data_length_max;
         
     private:
         bool     m_alloced;
-        int      m_data_length;
-        int      m_data_length_max;
 };
 
 #endif // __DATA_WRAPPER_H__
\ No newline at end of file
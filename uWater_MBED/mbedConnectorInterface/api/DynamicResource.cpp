@@ -41,6 +41,10 @@
 // ContentFormat defaults for each DynamicResource
 #define DEFAULT_CONTENT_FORMAT 0
 
+// Block-wise transfer: 2.31 Continue (not in the libnsdl response code list)
+#define COAP_MSG_CODE_RESPONSE_CONTINUE 95
+#define BLOCK_OPTION_MORE               0x08
+
 // default constructor
 DynamicResource::DynamicResource(const Logger *logger,const char *name,const char *res_type,uint8_t res_mask,const bool observable) : Resource<string>(logger,string(name),string(""))
 {
@@ -138,22 +142,46 @@ uint8_t DynamicResource::process(sn_coap_hdr_s *received_coap_ptr, sn_nsdl_addr_
     string key = this->coapDataToString(received_coap_ptr->uri_path_ptr,received_coap_ptr->uri_path_len);
     this->setDataWrapper(hold);
 
-    if(received_coap_ptr->msg_code == COAP_MSG_CODE_REQUEST_GET) {
+    // block-wise transfers: streamed GETs and Block1 uploads
+    if (this->processBlockwise(received_coap_ptr,address,key)) return 0;
+
+    // GET: typed resources encode straight into the payload in the requested (Accept) or default content-format
+    uint16_t content_format = this->m_content_format;
+    uint8_t encoded[MAX_PAYLOAD_BUFFER_LENGTH];
+    int encoded_length = -1;
+    if(received_coap_ptr->msg_code == COAP_MSG_CODE_REQUEST_GET && (this->m_res_mask&SN_GRS_GET_ALLOWED) != 0) {
+        content_format = this->acceptedFormat(received_coap_ptr);
+        encoded_length = this->encode(content_format,encoded,MAX_PAYLOAD_BUFFER_LENGTH);
+    }
+
+    if(received_coap_ptr->msg_code == COAP_MSG_CODE_REQUEST_GET && encoded_length < 0 && content_format != this->m_content_format) {
+        // we cannot produce the requested content-format
+        this->logger()->log("resource(GET) for [%s]: content-format %d not acceptable",key.c_str(),content_format);
+        coap_res_ptr = sn_coap_build_response(received_coap_ptr,COAP_MSG_CODE_RESPONSE_NOT_ACCEPTABLE);
+        sn_nsdl_send_coap_message(address,coap_res_ptr);
+    } else if(received_coap_ptr->msg_code == COAP_MSG_CODE_REQUEST_GET) {
         coap_res_ptr = sn_coap_build_response(received_coap_ptr, COAP_MSG_CODE_RESPONSE_CONTENT);
 
         // process the GET if we have registered a callback for it...
         if ((this->m_res_mask&SN_GRS_GET_ALLOWED) != 0) {
-            // call the resource get() to get the resource value
-            this->logger()->log("Calling resource(GET) for [%s]...",key.c_str());
-            string value = this->get();
+            // call the resource get() to get the resource value (unless already encoded)
+            string value;
+            uint8_t *payload = encoded;
+            int payload_length = encoded_length;
+            if (encoded_length < 0) {
+                this->logger()->log("Calling resource(GET) for [%s]...",key.c_str());
+                value = this->get();
+                payload = (uint8_t *)value.c_str();
+                payload_length = (int)value.size();
+            }
 
-            // convert the string from the GET to something suitable for CoAP payloads          
+            // convert the value from the GET to something suitable for CoAP payloads          
             if (this->getDataWrapper() != NULL) {
                 // wrap the data...
-                this->getDataWrapper()->wrap((uint8_t *)value.c_str(),(int)value.size());
+                this->getDataWrapper()->wrap(payload,payload_length);
                 
                 // announce (after wrap)
-                this->logger()->log("Building payload for [%s]=[%s]...",key.c_str(),this->getDataWrapper()->get());
+                this->logger()->log("Building payload for [%s] (%d bytes wrapped)...",key.c_str(),this->getDataWrapper()->length());
                 
                 // fill in the CoAP response payload
                 coap_res_ptr->payload_len = this->getDataWrapper()->length();
@@ -161,16 +189,20 @@ uint8_t DynamicResource::process(sn_coap_hdr_s *received_coap_ptr, sn_nsdl_addr_
             }
             else {
                 // announce (no wrap)
-                this->logger()->log("Building payload for [%s]=[%s]...",key.c_str(),value.c_str());
+                if (encoded_length < 0) this->logger()->log("Building payload for [%s]=[%s]...",key.c_str(),value.c_str());
+                else this->logger()->log("Building payload for [%s] (%d bytes, content-format %d)...",key.c_str(),payload_length,content_format);
                 
                 // do not wrap the data...
-                coap_res_ptr->payload_len = value.size();
-                coap_res_ptr->payload_ptr = (uint8_t *)value.c_str();
+                coap_res_ptr->payload_len = payload_length;
+                coap_res_ptr->payload_ptr = payload;
             }
             
-            // CoAP Content-Format
-            coap_res_ptr->content_type_ptr = &this->m_content_format;                       
-            coap_res_ptr->content_type_len = sizeof(this->m_content_format);
+            // CoAP Content-Format (CoAP uint option: one byte up to 255, two bytes beyond)
+            int content_format_length = 0;
+            if (content_format > 0xFF) this->m_content_format_buffer[content_format_length++] = (uint8_t)(content_format >> 8);
+            this->m_content_format_buffer[content_format_length++] = (uint8_t)(content_format & 0xFF);
+            coap_res_ptr->content_type_ptr = this->m_content_format_buffer;                       
+            coap_res_ptr->content_type_len = content_format_length;
             
             // max-age cache control
             coap_res_ptr->options_list_ptr = (sn_coap_options_list_s*)nsdl_alloc(sizeof(sn_coap_options_list_s));
@@ -262,12 +294,19 @@ uint8_t DynamicResource::process(sn_coap_hdr_s *received_coap_ptr, sn_nsdl_addr_
         if(received_coap_ptr->payload_len > 0) {
             // process the PUT if we have registered a callback for it...
             if ((this->m_res_mask&SN_GRS_PUT_ALLOWED) != 0) {
-                // put() delivers values as std::string
-                string value = this->coapDataToString(received_coap_ptr->payload_ptr,received_coap_ptr->payload_len);
+                // typed resources decode binary payloads directly...
+                uint16_t payload_format = this->payloadFormat(received_coap_ptr);
+                if (payload_format != CONTENT_FORMAT_TEXT_PLAIN && this->decodePayload(payload_format,received_coap_ptr->payload_ptr,received_coap_ptr->payload_len)) {
+                    this->logger()->log("resource(PUT) decoded [%s] (content-format %d)...",key.c_str(),payload_format);
+                }
+                else {
+                    // put() delivers values as std::string
+                    string value = this->coapDataToString(received_coap_ptr->payload_ptr,received_coap_ptr->payload_len);
 
-                // call the resource put() to set the resource value
-                this->logger()->log("Calling resource(PUT) with [%s]=[%s]...",key.c_str(),value.c_str());
-                this->put(value);
+                    // call the resource put() to set the resource value
+                    this->logger()->log("Calling resource(PUT) with [%s]=[%s]...",key.c_str(),value.c_str());
+                    this->put(value);
+                }
 
                 // build out the response and send...
                 this->logger()->log("resource(PUT) completed for [%s]...",key.c_str());
@@ -283,12 +322,19 @@ uint8_t DynamicResource::process(sn_coap_hdr_s *received_coap_ptr, sn_nsdl_addr_
         if(received_coap_ptr->payload_len > 0) {
             // process the POST if we have registered a callback for it...
             if ((this->m_res_mask&SN_GRS_POST_ALLOWED) != 0) {
-                // post() delivers values as std::string
-                string value = this->coapDataToString(received_coap_ptr->payload_ptr,received_coap_ptr->payload_len);
+                // typed resources decode binary payloads directly...
+                uint16_t payload_format = this->payloadFormat(received_coap_ptr);
+                if (payload_format != CONTENT_FORMAT_TEXT_PLAIN && this->decodePayload(payload_format,received_coap_ptr->payload_ptr,received_coap_ptr->payload_len)) {
+                    this->logger()->log("resource(POST) decoded [%s] (content-format %d)...",key.c_str(),payload_format);
+                }
+                else {
+                    // post() delivers values as std::string
+                    string value = this->coapDataToString(received_coap_ptr->payload_ptr,received_coap_ptr->payload_len);
 
-                // call the resource post() to set the resource value
-                this->logger()->log("Calling resource(POST) with [%s]=[%s]...",key.c_str(),value.c_str());
-                this->post(value);
+                    // call the resource post() to set the resource value
+                    this->logger()->log("Calling resource(POST) with [%s]=[%s]...",key.c_str(),value.c_str());
+                    this->post(value);
+                }
 
                 // build out the response and send...
                 this->logger()->log("resource(POST) completed for [%s]...",key.c_str());
@@ -335,6 +381,11 @@ int DynamicResource::notify(const string data) {
 
 // send the notification
 int DynamicResource::notify(uint8_t *data,int data_length) {
+    return this->notify(data,data_length,CONTENT_FORMAT_TEXT_PLAIN);
+}
+
+// send the notification (libnsdl carries a single byte content-format in notifications)
+int DynamicResource::notify(uint8_t *data,int data_length,uint16_t content_format) {
     uint8_t *notify_data = NULL;
     int notify_data_length = 0;
     
@@ -360,7 +411,11 @@ int DynamicResource::notify(uint8_t *data,int data_length) {
     }
     
     // send the observation...
-    int status = sn_nsdl_send_observation_notification(this->m_obs_token_ptr,this->m_obs_token_len,notify_data,notify_data_length,&this->m_obs_number,1,COAP_MSG_TYPE_NON_CONFIRMABLE,0);
+    if (content_format > 0xFF) {
+        this->logger()->log("ERROR: resource(NOTIFY) content-format %d cannot be sent in a notification...",content_format);
+        return 0;
+    }
+    int status = sn_nsdl_send_observation_notification(this->m_obs_token_ptr,this->m_obs_token_len,notify_data,notify_data_length,&this->m_obs_number,1,COAP_MSG_TYPE_NON_CONFIRMABLE,(uint8_t)content_format);
     if (status == 0) {
         this->logger()->log("ERROR: resource(NOTIFY) send failed...");
     }
@@ -406,7 +461,7 @@ void DynamicResource::setObserver(void *observer) {
 }
 
 // set the content-format in responses
-void DynamicResource::setContentFormat(uint8_t content_format) {
+void DynamicResource::setContentFormat(uint16_t content_format) {
     this->m_content_format = content_format;
 }
 
@@ -435,3 +490,229 @@ string DynamicResource::coapDataToString(uint8_t *coap_data_ptr,int coap_data_pt
     }
     return string("");
 }
+
+// content-format asked for in the Accept option (default: our own)
+uint16_t DynamicResource::acceptedFormat(sn_coap_hdr_s *received_coap_ptr)
+{
+    sn_coap_options_list_s *options = received_coap_ptr->options_list_ptr;
+    if (options != NULL && options->accept_ptr != NULL && options->accept_len > 0 && options->accept_len <= 2) {
+        uint16_t accept = options->accept_ptr[0];
+        if (options->accept_len == 2) accept = (accept << 8) | options->accept_ptr[1];
+        return accept;
+    }
+    return this->m_content_format;
+}
+
+// content-format of a request payload (default: text/plain)
+uint16_t DynamicResource::payloadFormat(sn_coap_hdr_s *received_coap_ptr)
+{
+    if (received_coap_ptr->content_type_ptr != NULL && received_coap_ptr->content_type_len > 0 && received_coap_ptr->content_type_len <= 2) {
+        uint16_t content_format = received_coap_ptr->content_type_ptr[0];
+        if (received_coap_ptr->content_type_len == 2) content_format = (content_format << 8) | received_coap_ptr->content_type_ptr[1];
+        return content_format;
+    }
+    return CONTENT_FORMAT_TEXT_PLAIN;
+}
+
+// unwrap (if needed) and hand a binary payload to the typed decoder
+bool DynamicResource::decodePayload(uint16_t content_format,uint8_t *coap_data_ptr,int coap_data_ptr_length)
+{
+    if (coap_data_ptr == NULL || coap_data_ptr_length <= 0) return false;
+    if (this->getDataWrapper() != NULL) {
+        this->getDataWrapper()->unwrap(coap_data_ptr,coap_data_ptr_length);
+        return this->decode(content_format,this->getDataWrapper()->get(),this->getDataWrapper()->length());
+    }
+    return this->decode(content_format,coap_data_ptr,coap_data_ptr_length);
+}
+
+// default batched encoding: the string value as an LWM2M string/SenML string value
+int DynamicResource::encodeMember(uint16_t content_format,uint8_t *buffer,int buffer_length)
+{
+    string value = this->get();
+    int length = 0;
+    int n = 0;
+    switch(content_format) {
+        case CONTENT_FORMAT_LWM2M_TLV:
+            return ValueCodec::tlvOpaque(DynamicResource::resourceId(this->getName().c_str()),(const uint8_t *)value.c_str(),(int)value.size(),buffer,buffer_length);
+        case CONTENT_FORMAT_SENML_JSON:
+            length = ValueCodec::literal("\"vs\":",buffer,buffer_length);
+            if (length < 0) return -1;
+            n = ValueCodec::jsonString(value.c_str(),(int)value.size(),buffer+length,buffer_length-length);
+            return (n < 0) ? -1 : length + n;
+        case CONTENT_FORMAT_SENML_CBOR:
+            length = ValueCodec::cborInteger(SENML_LABEL_STRING_VALUE,buffer,buffer_length);
+            if (length < 0) return -1;
+            n = ValueCodec::cborText(value.c_str(),(int)value.size(),buffer+length,buffer_length-length);
+            return (n < 0) ? -1 : length + n;
+        default:
+            return -1;
+    }
+}
+
+// LWM2M resource ID: the last segment of the resource name
+uint16_t DynamicResource::resourceId(const char *name)
+{
+    const char *last = strrchr(name,'/');
+    return (uint16_t)atoi((last != NULL) ? last + 1 : name);
+}
+
+// Block option value: NUM | M | SZX (block size = 2^(SZX+4))
+static bool parse_block_option(const uint8_t *option,uint8_t option_length,uint32_t *num,bool *more,uint8_t *szx)
+{
+    if (option == NULL || option_length == 0 || option_length > 3) return false;
+    uint32_t value = 0;
+    for(int i=0;i<option_length;++i) value = (value << 8) | option[i];
+    *num = value >> 4;
+    *more = ((value & BLOCK_OPTION_MORE) != 0);
+    *szx = value & 0x07;
+    return (*szx < 7);                  // SZX 7 is reserved
+}
+
+static uint8_t build_block_option(uint32_t num,bool more,uint8_t szx,uint8_t *option)
+{
+    uint32_t value = (num << 4) | (more ? BLOCK_OPTION_MORE : 0) | szx;
+    if (value <= 0xFF) {
+        option[0] = (uint8_t)value;
+        return 1;
+    }
+    if (value <= 0xFFFF) {
+        option[0] = (uint8_t)(value >> 8);
+        option[1] = (uint8_t)value;
+        return 2;
+    }
+    option[0] = (uint8_t)(value >> 16);
+    option[1] = (uint8_t)(value >> 8);
+    option[2] = (uint8_t)value;
+    return 3;
+}
+
+// our preferred block size exponent (NSP_BLOCK_SIZE = 2^(SZX+4))
+static uint8_t preferred_block_szx()
+{
+    uint8_t szx = 0;
+    while(szx < 6 && (16 << (szx+1)) <= NSP_BLOCK_SIZE) ++szx;
+    return szx;
+}
+
+// block-wise requests are answered here
+bool DynamicResource::processBlockwise(sn_coap_hdr_s *received_coap_ptr,sn_nsdl_addr_s *address,const string &key)
+{
+    sn_coap_options_list_s *options = received_coap_ptr->options_list_ptr;
+
+    // GET of a streamed resource
+    if (received_coap_ptr->msg_code == COAP_MSG_CODE_REQUEST_GET && (this->m_res_mask&SN_GRS_GET_ALLOWED) != 0 && this->generate(0,NULL,0) >= 0) {
+        this->sendBlock2(received_coap_ptr,address,key);
+        return true;
+    }
+
+    // PUT/POST carrying a Block1 option
+    if (options != NULL && options->block1_ptr != NULL && options->block1_len > 0) {
+        if ((received_coap_ptr->msg_code == COAP_MSG_CODE_REQUEST_PUT && (this->m_res_mask&SN_GRS_PUT_ALLOWED) != 0) ||
+            (received_coap_ptr->msg_code == COAP_MSG_CODE_REQUEST_POST && (this->m_res_mask&SN_GRS_POST_ALLOWED) != 0)) {
+            this->acceptBlock1(received_coap_ptr,address,key);
+            return true;
+        }
+    }
+    return false;
+}
+
+// send one block of a streamed resource
+void DynamicResource::sendBlock2(sn_coap_hdr_s *received_coap_ptr,sn_nsdl_addr_s *address,const string &key)
+{
+    sn_coap_options_list_s *options = received_coap_ptr->options_list_ptr;
+    uint32_t num = 0;
+    bool more = false;
+    uint8_t szx = preferred_block_szx();
+    bool requested = false;
+
+    // the client may ask for a given block and a smaller size
+    if (options != NULL && options->block2_ptr != NULL) {
+        uint8_t requested_szx = szx;
+        requested = parse_block_option(options->block2_ptr,options->block2_len,&num,&more,&requested_szx);
+        if (requested && requested_szx < szx) szx = requested_szx;
+    }
+    int block_size = 16 << szx;
+
+    // generate one byte more than the block to learn whether more blocks follow
+    uint8_t *block = (uint8_t *)nsdl_alloc(block_size + 1);
+    int length = (block != NULL) ? this->generate(num * block_size,block,block_size + 1) : -1;
+    sn_coap_hdr_s *coap_res_ptr = NULL;
+    if (length < 0) {
+        this->logger()->log("ERROR: resource(GET) unable to generate block %d of [%s]",num,key.c_str());
+        coap_res_ptr = sn_coap_build_response(received_coap_ptr,COAP_MSG_CODE_RESPONSE_INTERNAL_SERVER_ERROR);
+        sn_nsdl_send_coap_message(address,coap_res_ptr);
+        sn_coap_parser_release_allocated_coap_msg_mem(coap_res_ptr);
+        nsdl_free(block);
+        return;
+    }
+    more = (length > block_size);
+    if (more) length = block_size;
+
+    coap_res_ptr = sn_coap_build_response(received_coap_ptr,COAP_MSG_CODE_RESPONSE_CONTENT);
+    coap_res_ptr->payload_ptr = block;
+    coap_res_ptr->payload_len = length;
+
+    // CoAP Content-Format
+    int content_format_length = 0;
+    if (this->m_content_format > 0xFF) this->m_content_format_buffer[content_format_length++] = (uint8_t)(this->m_content_format >> 8);
+    this->m_content_format_buffer[content_format_length++] = (uint8_t)(this->m_content_format & 0xFF);
+    coap_res_ptr->content_type_ptr = this->m_content_format_buffer;
+    coap_res_ptr->content_type_len = content_format_length;
+
+    // max-age and Block2 (omitted when the whole value fits in the first block and no block was asked for)
+    coap_res_ptr->options_list_ptr = (sn_coap_options_list_s*)nsdl_alloc(sizeof(sn_coap_options_list_s));
+    if (coap_res_ptr->options_list_ptr != NULL) {
+        memset(coap_res_ptr->options_list_ptr,0,sizeof(sn_coap_options_list_s));
+        coap_res_ptr->options_list_ptr->max_age_ptr = &this->m_maxage;
+        coap_res_ptr->options_list_ptr->max_age_len = sizeof(this->m_maxage);
+        if (requested || more) {
+            coap_res_ptr->options_list_ptr->block2_len = build_block_option(num,more,szx,this->m_block_option);
+            coap_res_ptr->options_list_ptr->block2_ptr = this->m_block_option;
+        }
+    }
+
+    this->logger()->log("resource(GET) block %d (%d bytes, more: %d) for [%s]...",num,length,more,key.c_str());
+    sn_nsdl_send_coap_message(address,coap_res_ptr);
+
+    // our buffers are not the library's to free
+    nsdl_free(coap_res_ptr->options_list_ptr);
+    coap_res_ptr->options_list_ptr = NULL;
+    coap_res_ptr->content_type_ptr = NULL;
+    coap_res_ptr->payload_ptr = NULL;
+    sn_coap_parser_release_allocated_coap_msg_mem(coap_res_ptr);
+    nsdl_free(block);
+}
+
+// accept one block of a Block1 PUT/POST
+void DynamicResource::acceptBlock1(sn_coap_hdr_s *received_coap_ptr,sn_nsdl_addr_s *address,const string &key)
+{
+    sn_coap_options_list_s *options = received_coap_ptr->options_list_ptr;
+    uint32_t num = 0;
+    bool more = false;
+    uint8_t szx = 0;
+    sn_coap_hdr_s *coap_res_ptr = NULL;
+
+    if (!parse_block_option(options->block1_ptr,options->block1_len,&num,&more,&szx)) {
+        coap_res_ptr = sn_coap_build_response(received_coap_ptr,COAP_MSG_CODE_RESPONSE_BAD_OPTION);
+    }
+    else if (!this->consume(num * (16 << szx),received_coap_ptr->payload_ptr,received_coap_ptr->payload_len,!more)) {
+        this->logger()->log("ERROR: resource(PUT/POST) block %d rejected for [%s]",num,key.c_str());
+        coap_res_ptr = sn_coap_build_response(received_coap_ptr,COAP_MSG_CODE_RESPONSE_REQUEST_ENTITY_TOO_LARGE);
+    }
+    else {
+        // 2.31 Continue until the last block, then 2.04 Changed - both echo the Block1 option
+        this->logger()->log("resource(PUT/POST) block %d (%d bytes, more: %d) accepted for [%s]...",num,received_coap_ptr->payload_len,more,key.c_str());
+        coap_res_ptr = sn_coap_build_response(received_coap_ptr,more ? (uint8_t)COAP_MSG_CODE_RESPONSE_CONTINUE : (uint8_t)COAP_MSG_CODE_RESPONSE_CHANGED);
+        coap_res_ptr->options_list_ptr = (sn_coap_options_list_s*)nsdl_alloc(sizeof(sn_coap_options_list_s));
+        if (coap_res_ptr->options_list_ptr != NULL) {
+            memset(coap_res_ptr->options_list_ptr,0,sizeof(sn_coap_options_list_s));
+            coap_res_ptr->options_list_ptr->block1_len = build_block_option(num,more,szx,this->m_block_option);
+            coap_res_ptr->options_list_ptr->block1_ptr = this->m_block_option;
+        }
+    }
+
+    sn_nsdl_send_coap_message(address,coap_res_ptr);
+    nsdl_free(coap_res_ptr->options_list_ptr);
+    coap_res_ptr->options_list_ptr = NULL;
+    sn_coap_parser_release_allocated_coap_msg_mem(coap_res_ptr);
+}
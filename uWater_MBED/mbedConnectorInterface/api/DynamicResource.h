@@ -32,6 +32,9 @@
 // DataWrapper support
 #include "DataWrapper.h"
 
+// Content-Format IDs
+#include "ValueCodec.h"
+
 /** DynamicResource class
  */
 class DynamicResource : public Resource<string>
@@ -140,9 +143,15 @@ public:
     
     /**
     Set the content format for responses
-    @param content_format short integer CoAP content-format ID
+    @param content_format CoAP content-format ID
+    */
+    void setContentFormat(uint16_t content_format);
+
+    /**
+    Get the content format for responses
+    @return CoAP content-format ID
     */
-    void setContentFormat(uint8_t content_format);
+    uint16_t getContentFormat() { return this->m_content_format; }
 
     /**
     Set the max-age for cache control of responses in a proxy cache
@@ -160,10 +169,63 @@ public:
     observe the resource
     */
     virtual void observe();
+
+    /**
+    Encode this resource as one member of a batched (object-level or composite) read
+    @param content_format input CONTENT_FORMAT_LWM2M_TLV (the resource TLV) or CONTENT_FORMAT_SENML_JSON/CBOR (the SenML value field)
+    @param buffer output the buffer
+    @param buffer_length input the buffer length
+    @return bytes written or -1
+    */
+    virtual int encodeMember(uint16_t content_format,uint8_t *buffer,int buffer_length);
     
 protected:
     int notify(uint8_t *data,int data_length);
+    int notify(uint8_t *data,int data_length,uint16_t content_format);
     DataWrapper *getDataWrapper() { return this->m_data_wrapper; }
+
+    /**
+    Encode the resource value directly into a CoAP payload (OPTIONAL: typed resources override this)
+    @param content_format input the requested CoAP content-format ID
+    @param buffer output the payload buffer
+    @param buffer_length input the payload buffer length
+    @return payload length, or -1 to fall back to the string get()
+    */
+    virtual int encode(uint16_t content_format,uint8_t *buffer,int buffer_length) { return -1; }
+
+    /**
+    Decode a PUT/POST payload directly (OPTIONAL: typed resources override this)
+    @param content_format input the CoAP content-format ID of the payload
+    @param data input the (unwrapped) payload
+    @param data_length input the payload length
+    @return true if consumed, false to fall back to the string put()/post()
+    */
+    virtual bool decode(uint16_t content_format,const uint8_t *data,int data_length) { return false; }
+
+    /**
+    Stream the resource value for block-wise GETs (OPTIONAL: resources with large values override this)
+    The value is produced a block at a time - it is never materialized as a whole. DynamicResource
+    probes for support with a NULL buffer.
+    @param offset input byte offset into the value
+    @param buffer output the block buffer (NULL: probe)
+    @param buffer_length input the buffer length
+    @return bytes written (fewer than buffer_length only at the end of the value), or -1 if not streamed
+    */
+    virtual int generate(uint32_t offset,uint8_t *buffer,int buffer_length) { return -1; }
+
+    /**
+    Accept one block of a block-wise (Block1) PUT/POST (OPTIONAL: resources accepting large values override this)
+    @param offset input byte offset of the block
+    @param data input the block
+    @param data_length input the block length
+    @param last input true for the final block
+    @return true if accepted, false to reject the transfer
+    */
+    virtual bool consume(uint32_t offset,const uint8_t *data,int data_length,bool last) { return false; }
+
+    // LWM2M resource ID: the last segment of a resource name
+    static uint16_t resourceId(const char *name);
+
     bool              m_observable;
      
 private:
@@ -176,10 +238,22 @@ private:
     DataWrapper      *m_data_wrapper;
     void             *m_observer;
     uint8_t           m_maxage;
-    uint8_t           m_content_format;
+    uint16_t          m_content_format;
+    uint8_t           m_content_format_buffer[2];
+    uint8_t           m_block_option[3];
 
     // convenience method to create a string from the NSDL CoAP data buffers...
     string coapDataToString(uint8_t *coap_data_ptr,int coap_data_ptr_length);
+
+    // Content-Format helpers: Accept option of a request, Content-Format of a payload, and typed decoding
+    uint16_t acceptedFormat(sn_coap_hdr_s *received_coap_ptr);
+    uint16_t payloadFormat(sn_coap_hdr_s *received_coap_ptr);
+    bool decodePayload(uint16_t content_format,uint8_t *coap_data_ptr,int coap_data_ptr_length);
+
+    // block-wise transfer (RFC 7959) handling: true if the request was answered here
+    bool processBlockwise(sn_coap_hdr_s *received_coap_ptr,sn_nsdl_addr_s *address,const string &key);
+    void sendBlock2(sn_coap_hdr_s *received_coap_ptr,sn_nsdl_addr_s *address,const string &key);
+    void acceptBlock1(sn_coap_hdr_s *received_coap_ptr,sn_nsdl_addr_s *address,const string &key);
 };
 
 #endif // __DYNAMIC_RESOURCE_H__
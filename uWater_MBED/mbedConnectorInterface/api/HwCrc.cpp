@@ -0,0 +1,225 @@
+/**
+ * @file    HwCrc.cpp
+ * @brief   CRC-16/CCITT and CRC-32 utility using the K64F CRC module (implementation)
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HwCrc.h"
+
+// switch for thread support (from mbedEndpointNetwork)
+#include "configuration.h"
+
+#ifdef CONNECTOR_USING_THREADS
+    #include "rtos.h"
+#endif
+
+// the K64F has a CRC module and an eDMA engine to feed it
+#if defined(TARGET_K64F)
+    #define USE_HW_CRC  1
+#endif
+
+// CRC parameters
+#define CRC16_POLY      0x1021
+#define CRC16_INIT      0xFFFF
+#define CRC32_POLY      0x04C11DB7
+#define CRC32_POLY_REF  0xEDB88320      // CRC32_POLY bit reversed
+#define CRC32_INIT      0xFFFFFFFF
+#define CRC32_XOROUT    0xFFFFFFFF
+
+// lookup tables (built once, on first use)
+static uint16_t crc16_table[256];
+static uint32_t crc32_table[256];
+static bool     crc_tables_built = false;
+
+static void build_tables() {
+    for(int i=0;i<256;++i) {
+        uint16_t c16 = (uint16_t)(i << 8);
+        uint32_t c32 = (uint32_t)i;
+        for(int j=0;j<8;++j) {
+            c16 = (c16 & 0x8000) ? (uint16_t)((c16 << 1) ^ CRC16_POLY) : (uint16_t)(c16 << 1);
+            c32 = (c32 & 1) ? ((c32 >> 1) ^ CRC32_POLY_REF) : (c32 >> 1);
+        }
+        crc16_table[i] = c16;
+        crc32_table[i] = c32;
+    }
+    crc_tables_built = true;
+}
+
+#ifdef USE_HW_CRC
+// CRC_CTRL fields
+#define CRC_CTRL_TOT_BITS_BYTES     CRC_CTRL_TOT(2)     // input transposed in bits and bytes (reflected input)
+#define CRC_CTRL_TOT_BYTES          CRC_CTRL_TOT(3)     // input transposed in bytes only (little endian words, MSB first bits)
+
+#ifdef CONNECTOR_USING_THREADS
+// the CRC module (and our DMA channel) is shared between all HwCrc instances
+static Mutex crc_engine_lock;
+#endif
+
+// bit reverse a word
+static inline uint32_t reflect32(uint32_t value) {
+    return __RBIT(value);
+}
+
+// feed word aligned data to the CRC module via a software started eDMA transfer (single major loop)
+static void dma_feed(const uint32_t *words,int num_words) {
+    volatile DMA_Type *dma = DMA0;
+    int ch = HW_CRC_DMA_CHANNEL;
+
+    SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+    dma->CERQ = DMA_CERQ_CERQ(ch);          // no hardware requests on our channel
+    dma->CDNE = DMA_CDNE_CDNE(ch);
+    dma->TCD[ch].SADDR = (uint32_t)words;
+    dma->TCD[ch].SOFF = 4;
+    dma->TCD[ch].ATTR = DMA_ATTR_SSIZE(2) | DMA_ATTR_DSIZE(2);
+    dma->TCD[ch].NBYTES_MLNO = (uint32_t)(num_words*4);
+    dma->TCD[ch].SLAST = 0;
+    dma->TCD[ch].DADDR = (uint32_t)&CRC0->DATA;
+    dma->TCD[ch].DOFF = 0;
+    dma->TCD[ch].CITER_ELINKNO = 1;
+    dma->TCD[ch].DLAST_SGA = 0;
+    dma->TCD[ch].BITER_ELINKNO = 1;
+    dma->TCD[ch].CSR = DMA_CSR_START_MASK;
+
+    // the whole buffer moves as a single minor loop - wait for it
+    while((dma->TCD[ch].CSR & DMA_CSR_DONE_MASK) == 0) ;
+    dma->CDNE = DMA_CDNE_CDNE(ch);
+}
+#endif
+
+// default constructor
+HwCrc::HwCrc(CrcType type) {
+    if (!crc_tables_built) build_tables();
+    this->m_type = type;
+    this->m_use_hardware = true;
+    this->reset();
+}
+
+// destructor
+HwCrc::~HwCrc() {
+}
+
+// restart
+void HwCrc::reset() {
+    // running state: CRC-16 is kept MSB first, CRC-32 is kept reflected
+    this->m_state = (this->m_type == CRC32) ? CRC32_INIT : CRC16_INIT;
+}
+
+// feed data
+void HwCrc::update(const void *data,int length) {
+    if (data == NULL || length <= 0) return;
+#ifdef USE_HW_CRC
+    if (this->m_use_hardware) {
+        this->updateHardware((const uint8_t *)data,length);
+        return;
+    }
+#endif
+    this->updateSoftware((const uint8_t *)data,length);
+}
+
+// current CRC value
+uint32_t HwCrc::value() {
+    if (this->m_type == CRC32) return this->m_state ^ CRC32_XOROUT;
+    return this->m_state & 0xFFFF;
+}
+
+// one shot CRC
+uint32_t HwCrc::compute(CrcType type,const void *data,int length) {
+    HwCrc crc(type);
+    crc.update(data,length);
+    return crc.value();
+}
+
+// one shot CRC (software)
+uint32_t HwCrc::computeSoftware(CrcType type,const void *data,int length) {
+    HwCrc crc(type);
+    crc.useHardware(false);
+    crc.update(data,length);
+    return crc.value();
+}
+
+// table driven update
+void HwCrc::updateSoftware(const uint8_t *data,int length) {
+    uint32_t crc = this->m_state;
+    if (this->m_type == CRC32) {
+        for(int i=0;i<length;++i) crc = (crc >> 8) ^ crc32_table[(crc ^ data[i]) & 0xFF];
+    }
+    else {
+        for(int i=0;i<length;++i) crc = ((crc << 8) ^ crc16_table[((crc >> 8) ^ data[i]) & 0xFF]) & 0xFFFF;
+    }
+    this->m_state = crc;
+}
+
+// CRC module update
+void HwCrc::updateHardware(const uint8_t *data,int length) {
+#ifdef USE_HW_CRC
+    bool crc32 = (this->m_type == CRC32);
+    uint32_t width = crc32 ? CRC_CTRL_TCRC_MASK : 0;
+
+#ifdef CONNECTOR_USING_THREADS
+    crc_engine_lock.lock();
+#endif
+    SIM->SCGC6 |= SIM_SCGC6_CRC_MASK;
+
+    // seed the engine with our running state (raw, untransposed)
+    CRC0->GPOLY = crc32 ? CRC32_POLY : CRC16_POLY;
+    CRC0->CTRL = width | CRC_CTRL_WAS_MASK;
+    CRC0->DATA = crc32 ? reflect32(this->m_state) : this->m_state;
+
+    // data: CRC-32 is reflected (bits and bytes), CRC-16 is MSB first (bytes only)
+    CRC0->CTRL = width | (crc32 ? CRC_CTRL_TOT_BITS_BYTES : CRC_CTRL_TOT_BYTES);
+
+    // unaligned head
+    while(length > 0 && ((uint32_t)data & 3) != 0) {
+        CRC0->ACCESS8BIT.DATALL = *data++;
+        --length;
+    }
+
+    // aligned words - eDMA for long runs, CPU otherwise
+    int num_words = length / 4;
+    if (num_words > 0) {
+        const uint32_t *words = (const uint32_t *)data;
+        if (num_words*4 >= HW_CRC_DMA_THRESHOLD) {
+            dma_feed(words,num_words);
+        }
+        else {
+            for(int i=0;i<num_words;++i) CRC0->DATA = words[i];
+        }
+        data += num_words*4;
+        length -= num_words*4;
+    }
+
+    // tail
+    while(length > 0) {
+        CRC0->ACCESS8BIT.DATALL = *data++;
+        --length;
+    }
+
+    // read back the raw register and keep it in our running state form
+    CRC0->CTRL = width;
+    uint32_t raw = CRC0->DATA;
+    this->m_state = crc32 ? reflect32(raw) : (raw & 0xFFFF);
+
+#ifdef CONNECTOR_USING_THREADS
+    crc_engine_lock.unlock();
+#endif
+#else
+    this->updateSoftware(data,length);
+#endif
+}
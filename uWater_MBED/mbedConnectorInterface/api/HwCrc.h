@@ -0,0 +1,112 @@
+/**
+ * @file    HwCrc.h
+ * @brief   CRC-16/CCITT and CRC-32 utility using the K64F CRC module (header)
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HW_CRC_H__
+#define __HW_CRC_H__
+
+// mbed support
+#include "mbed.h"
+
+// Configuration
+#include "mbedConnectorInterface.h"
+
+/**
+ HwCrc computes CRC-16/CCITT (poly 0x1021, init 0xFFFF, check 0x29B1) and CRC-32
+ (IEEE 802.3, check 0xCBF43926). On the K64F the CRC module does the work, and buffers
+ of HW_CRC_DMA_THRESHOLD bytes or more are fed to it by eDMA. Elsewhere a table driven
+ software implementation produces identical results, so persistent formats written on
+ the board can be checked on a host.
+
+ Each HwCrc instance keeps its own running value, so several streams can be computed
+ concurrently; the CRC module itself is shared and is re-seeded on every update().
+ */
+class HwCrc {
+    public:
+        typedef enum {
+            CRC16_CCITT,
+            CRC32
+        } CrcType;
+
+        /**
+        Default constructor
+        @param type input the CRC flavor
+        */
+        HwCrc(CrcType type = CRC32);
+
+        /**
+        Destructor
+        */
+        virtual ~HwCrc();
+
+        /**
+        Restart the CRC computation
+        */
+        void reset();
+
+        /**
+        Feed data into the CRC
+        @param data input the data
+        @param length input the data length
+        */
+        void update(const void *data,int length);
+
+        /**
+        Get the CRC of all the data fed so far
+        @return the CRC (16 bit CRCs in the low half)
+        */
+        uint32_t value();
+
+        /**
+        Select the CRC module or the software implementation (no effect without a CRC module)
+        @param enable input true to use the CRC module if present
+        */
+        void useHardware(bool enable) { this->m_use_hardware = enable; }
+
+        /**
+        One shot CRC
+        @param type input the CRC flavor
+        @param data input the data
+        @param length input the data length
+        @return the CRC
+        */
+        static uint32_t compute(CrcType type,const void *data,int length);
+
+        /**
+        One shot CRC (software implementation only - the host side reference)
+        @param type input the CRC flavor
+        @param data input the data
+        @param length input the data length
+        @return the CRC
+        */
+        static uint32_t computeSoftware(CrcType type,const void *data,int length);
+
+    private:
+        CrcType  m_type;
+        uint32_t m_state;
+        bool     m_use_hardware;
+
+        // running state updates
+        void updateSoftware(const uint8_t *data,int length);
+        void updateHardware(const uint8_t *data,int length);
+};
+
+#endif // __HW_CRC_H__
@@ -47,6 +47,11 @@
  #endif
  }
  
+ // observation event: runs in the NSDL event loop (the only thread using libnsdl)
+ static void observe_resource(void *resource) {
+     ((DynamicResource *)resource)->observe();
+ }
+ 
  // notifier
  void ThreadedResourceObserver::_observation_notifier(void const *instance) {
  #ifdef CONNECTOR_USING_THREADS
@@ -54,7 +59,7 @@
      while(true) {
          Thread::wait(me->getSleepTime());
          if (me->isObserving() == true && me->getResource() != NULL && nsdl_endpoint_is_registered() == true) {
-             me->getResource()->observe();
+             nsdl_post_event(&observe_resource,me->getResource());
              //__threaded_led = !__threaded_led;
          }
      }
@@ -41,10 +41,15 @@
      this->stopObservation();
  }
 
- // notifier
+ // observation event: runs in the NSDL event loop (the only thread using libnsdl)
+ static void observe_resource(void *resource) {
+     ((DynamicResource *)resource)->observe();
+ }
+ 
+ // notifier (interrupt context: the observation is queued, never run here)
  void TickerResourceObserver::observationNotifier() {
      if (this->isObserving() == true && this->getResource() != NULL && nsdl_endpoint_is_registered() == true) {
-         this->getResource()->observe();
+         nsdl_post_event(&observe_resource,this->getResource());
          //__ticker_led = !__ticker_led;
      }
  }
@@ -0,0 +1,305 @@
+/**
+ * @file    TypedResource.h
+ * @brief   mbed CoAP Endpoint typed (binary encoded) Dynamic Resource class template
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TYPED_RESOURCE_H__
+#define __TYPED_RESOURCE_H__
+
+// Base class
+#include "DynamicResource.h"
+
+// Encoders
+#include "ValueCodec.h"
+
+// digits after the decimal point for float values in text/plain
+#define TYPED_RESOURCE_DEFAULT_DECIMALS  2
+
+/** OpaqueValue: a byte range for TypedResource<OpaqueValue> (the resource owns the bytes)
+ */
+typedef struct {
+    const uint8_t *data;
+    int            length;
+} OpaqueValue;
+
+/** TypedValueTraits: per type encoders used by TypedResource
+ */
+template <typename ValueType> struct TypedValueTraits;
+
+template <> struct TypedValueTraits<float> {
+    static int tlv(uint16_t id,float value,uint8_t *buffer,int buffer_length) { return ValueCodec::tlvFloat(id,value,buffer,buffer_length); }
+    static int cbor(float value,uint8_t *buffer,int buffer_length) { return ValueCodec::cborFloat(value,buffer,buffer_length); }
+    static int text(float value,int decimals,uint8_t *buffer,int buffer_length) { return ValueCodec::textFixed(value,decimals,(char *)buffer,buffer_length); }
+    static int senmlJson(float value,int decimals,uint8_t *buffer,int buffer_length) {
+        int length = ValueCodec::literal("\"v\":",buffer,buffer_length);
+        int n = (length < 0) ? -1 : ValueCodec::textFixed(value,decimals,(char *)buffer+length,buffer_length-length);
+        return (n < 0) ? -1 : length + n;
+    }
+    static int senmlCbor(float value,uint8_t *buffer,int buffer_length) {
+        int length = ValueCodec::cborInteger(SENML_LABEL_VALUE,buffer,buffer_length);
+        int n = (length < 0) ? -1 : ValueCodec::cborFloat(value,buffer+length,buffer_length-length);
+        return (n < 0) ? -1 : length + n;
+    }
+    static bool fromTlv(const uint8_t *value,int value_length,float *result) { return ValueCodec::tlvToFloat(value,value_length,result); }
+    static bool fromCbor(const uint8_t *data,int data_length,float *result) { return ValueCodec::cborToFloat(data,data_length,result); }
+    static bool fromText(const char *text,float *result) {
+        char *end = NULL;
+        *result = (float)strtod(text,&end);
+        return (end != text);
+    }
+};
+
+template <> struct TypedValueTraits<int> {
+    static int tlv(uint16_t id,int value,uint8_t *buffer,int buffer_length) { return ValueCodec::tlvInteger(id,value,buffer,buffer_length); }
+    static int cbor(int value,uint8_t *buffer,int buffer_length) { return ValueCodec::cborInteger(value,buffer,buffer_length); }
+    static int text(int value,int decimals,uint8_t *buffer,int buffer_length) { return ValueCodec::textInteger(value,(char *)buffer,buffer_length); }
+    static int senmlJson(int value,int decimals,uint8_t *buffer,int buffer_length) {
+        int length = ValueCodec::literal("\"v\":",buffer,buffer_length);
+        int n = (length < 0) ? -1 : ValueCodec::textInteger(value,(char *)buffer+length,buffer_length-length);
+        return (n < 0) ? -1 : length + n;
+    }
+    static int senmlCbor(int value,uint8_t *buffer,int buffer_length) {
+        int length = ValueCodec::cborInteger(SENML_LABEL_VALUE,buffer,buffer_length);
+        int n = (length < 0) ? -1 : ValueCodec::cborInteger(value,buffer+length,buffer_length-length);
+        return (n < 0) ? -1 : length + n;
+    }
+    static bool fromTlv(const uint8_t *value,int value_length,int *result) {
+        int64_t wide = 0;
+        if (!ValueCodec::tlvToInteger(value,value_length,&wide)) return false;
+        *result = (int)wide;
+        return true;
+    }
+    static bool fromCbor(const uint8_t *data,int data_length,int *result) {
+        int64_t wide = 0;
+        if (!ValueCodec::cborToInteger(data,data_length,&wide)) return false;
+        *result = (int)wide;
+        return true;
+    }
+    static bool fromText(const char *text,int *result) {
+        char *end = NULL;
+        *result = (int)strtol(text,&end,10);
+        return (end != text);
+    }
+};
+
+template <> struct TypedValueTraits<bool> {
+    static int tlv(uint16_t id,bool value,uint8_t *buffer,int buffer_length) { return ValueCodec::tlvBoolean(id,value,buffer,buffer_length); }
+    static int cbor(bool value,uint8_t *buffer,int buffer_length) { return ValueCodec::cborBoolean(value,buffer,buffer_length); }
+    static int text(bool value,int decimals,uint8_t *buffer,int buffer_length) {
+        if (buffer_length < 2) return -1;
+        buffer[0] = value ? '1' : '0';
+        buffer[1] = '\0';
+        return 1;
+    }
+    static int senmlJson(bool value,int decimals,uint8_t *buffer,int buffer_length) {
+        return ValueCodec::literal(value ? "\"vb\":true" : "\"vb\":false",buffer,buffer_length);
+    }
+    static int senmlCbor(bool value,uint8_t *buffer,int buffer_length) {
+        int length = ValueCodec::cborInteger(SENML_LABEL_BOOLEAN_VALUE,buffer,buffer_length);
+        int n = (length < 0) ? -1 : ValueCodec::cborBoolean(value,buffer+length,buffer_length-length);
+        return (n < 0) ? -1 : length + n;
+    }
+    static bool fromTlv(const uint8_t *value,int value_length,bool *result) { return ValueCodec::tlvToBoolean(value,value_length,result); }
+    static bool fromCbor(const uint8_t *data,int data_length,bool *result) { return ValueCodec::cborToBoolean(data,data_length,result); }
+    static bool fromText(const char *text,bool *result) {
+        if (strcmp(text,"1") == 0 || strcmp(text,"true") == 0) { *result = true; return true; }
+        if (strcmp(text,"0") == 0 || strcmp(text,"false") == 0) { *result = false; return true; }
+        return false;
+    }
+};
+
+template <> struct TypedValueTraits<OpaqueValue> {
+    static int tlv(uint16_t id,OpaqueValue value,uint8_t *buffer,int buffer_length) { return ValueCodec::tlvOpaque(id,value.data,value.length,buffer,buffer_length); }
+    static int cbor(OpaqueValue value,uint8_t *buffer,int buffer_length) { return ValueCodec::cborBytes(value.data,value.length,buffer,buffer_length); }
+    static int text(OpaqueValue value,int decimals,uint8_t *buffer,int buffer_length) {
+        if (value.length < 0 || value.length > buffer_length) return -1;
+        if (value.length > 0) memcpy(buffer,value.data,value.length);
+        return value.length;
+    }
+    static int senmlJson(OpaqueValue value,int decimals,uint8_t *buffer,int buffer_length) {
+        int length = ValueCodec::literal("\"vd\":\"",buffer,buffer_length);
+        int n = (length < 0) ? -1 : ValueCodec::base64url(value.data,value.length,buffer+length,buffer_length-length-1);
+        if (n < 0) return -1;
+        buffer[length+n] = '"';
+        return length + n + 1;
+    }
+    static int senmlCbor(OpaqueValue value,uint8_t *buffer,int buffer_length) {
+        int length = ValueCodec::cborInteger(SENML_LABEL_DATA_VALUE,buffer,buffer_length);
+        int n = (length < 0) ? -1 : ValueCodec::cborBytes(value.data,value.length,buffer+length,buffer_length-length);
+        return (n < 0) ? -1 : length + n;
+    }
+    static bool fromTlv(const uint8_t *value,int value_length,OpaqueValue *result) {
+        result->data = value;
+        result->length = value_length;
+        return true;
+    }
+    static bool fromCbor(const uint8_t *data,int data_length,OpaqueValue *result) { return ValueCodec::cborToBytes(data,data_length,&result->data,&result->length); }
+    static bool fromText(const char *text,OpaqueValue *result) {
+        result->data = (const uint8_t *)text;
+        result->length = strlen(text);
+        return true;
+    }
+};
+
+/** TypedResource class template
+
+ A DynamicResource whose value is a float, int, bool or OpaqueValue. Derived classes implement
+ read() (and optionally write()) on the native type; the value is encoded straight into the
+ CoAP payload as LWM2M TLV (default), CBOR or text/plain according to the resource content-format
+ or the request Accept option. PUT and POST both deliver the decoded value to write().
+ */
+template <typename ValueType> class TypedResource : public DynamicResource
+{
+public:
+    /**
+    Default constructor
+    @param logger input logger instance for this resource
+    @param name input the Resource URI/Name (the last path segment is the LWM2M resource ID)
+    @param res_type input type for the Resource
+    @param res_mask input the resource enablement mask (GET, PUT, etc...)
+    @param observable input the resource is Observable (default: FALSE)
+    @param content_format input default CoAP content-format (default: LWM2M TLV)
+    */
+    TypedResource(const Logger *logger,const char *name,const char *res_type,uint8_t res_mask,const bool observable = false,const uint16_t content_format = CONTENT_FORMAT_LWM2M_TLV) : DynamicResource(logger,name,res_type,res_mask,observable) {
+        this->setContentFormat(content_format);
+        this->m_resource_id = DynamicResource::resourceId(name);
+        this->m_decimals = TYPED_RESOURCE_DEFAULT_DECIMALS;
+    }
+
+    /**
+    Destructor
+    */
+    virtual ~TypedResource() {
+    }
+
+    /**
+    Resource value getter (REQUIRED: must be implemented in derived class)
+    @returns the resource value
+    */
+    virtual ValueType read() = 0;
+
+    /**
+    Resource value setter (OPTIONAL: defaulted noop if not derived)
+    @param value input the new resource value
+    */
+    virtual void write(const ValueType value) {
+        // not used by default
+        ;
+    }
+
+    /**
+    Set the digits after the decimal point used for float values in text/plain
+    @param decimals input digits after the decimal point (0-6)
+    */
+    void setDecimals(int decimals) { this->m_decimals = decimals; }
+
+    /**
+    text/plain getter (used by DynamicResource when no binary content-format applies)
+    */
+    virtual string get() {
+        uint8_t buffer[MAX_VALUE_BUFFER_LENGTH+1];
+        int length = TypedValueTraits<ValueType>::text(this->read(),this->m_decimals,buffer,MAX_VALUE_BUFFER_LENGTH+1);
+        if (length < 0) return string("");
+        return string((char *)buffer,length);
+    }
+
+    /**
+    text/plain setter (PUT)
+    */
+    virtual void put(const string value) {
+        ValueType typed;
+        if (TypedValueTraits<ValueType>::fromText(value.c_str(),&typed)) this->write(typed);
+        else this->logger()->log("TypedResource: unable to parse [%s] for [%s]",value.c_str(),this->getName().c_str());
+    }
+
+    /**
+    text/plain setter (POST)
+    */
+    virtual void post(const string value) {
+        this->put(value);
+    }
+
+    /**
+    observe the resource (notifications use CBOR when the default content-format does not fit in a notification)
+    */
+    virtual void observe() {
+        if (this->m_observable == true) {
+            uint16_t content_format = this->getContentFormat();
+            if (content_format > 0xFF) content_format = CONTENT_FORMAT_CBOR;
+            uint8_t buffer[MAX_VALUE_BUFFER_LENGTH];
+            int length = this->encode(content_format,buffer,MAX_VALUE_BUFFER_LENGTH);
+            if (length >= 0) this->notify(buffer,length,content_format);
+        }
+    }
+
+    /**
+    Encode this resource as one member of a batched read (LWM2M TLV record or SenML value field)
+    */
+    virtual int encodeMember(uint16_t content_format,uint8_t *buffer,int buffer_length) {
+        switch(content_format) {
+            case CONTENT_FORMAT_LWM2M_TLV:
+                return TypedValueTraits<ValueType>::tlv(this->m_resource_id,this->read(),buffer,buffer_length);
+            case CONTENT_FORMAT_SENML_JSON:
+                return TypedValueTraits<ValueType>::senmlJson(this->read(),this->m_decimals,buffer,buffer_length);
+            case CONTENT_FORMAT_SENML_CBOR:
+                return TypedValueTraits<ValueType>::senmlCbor(this->read(),buffer,buffer_length);
+            default:
+                return -1;
+        }
+    }
+
+protected:
+    // encode the value in the given content-format
+    virtual int encode(uint16_t content_format,uint8_t *buffer,int buffer_length) {
+        switch(content_format) {
+            case CONTENT_FORMAT_LWM2M_TLV:
+                return TypedValueTraits<ValueType>::tlv(this->m_resource_id,this->read(),buffer,buffer_length);
+            case CONTENT_FORMAT_CBOR:
+                return TypedValueTraits<ValueType>::cbor(this->read(),buffer,buffer_length);
+            case CONTENT_FORMAT_TEXT_PLAIN:
+                return TypedValueTraits<ValueType>::text(this->read(),this->m_decimals,buffer,buffer_length);
+            default:
+                return -1;
+        }
+    }
+
+    // decode a binary payload and hand it to write()
+    virtual bool decode(uint16_t content_format,const uint8_t *data,int data_length) {
+        ValueType typed;
+        bool decoded = false;
+        if (content_format == CONTENT_FORMAT_LWM2M_TLV) {
+            const uint8_t *value = NULL;
+            int value_length = 0;
+            if (ValueCodec::tlvParse(data,data_length,NULL,NULL,&value,&value_length) > 0) {
+                decoded = TypedValueTraits<ValueType>::fromTlv(value,value_length,&typed);
+            }
+        }
+        else if (content_format == CONTENT_FORMAT_CBOR) {
+            decoded = TypedValueTraits<ValueType>::fromCbor(data,data_length,&typed);
+        }
+        if (decoded) this->write(typed);
+        return decoded;
+    }
+
+    uint16_t m_resource_id;
+    int      m_decimals;
+};
+
+#endif // __TYPED_RESOURCE_H__
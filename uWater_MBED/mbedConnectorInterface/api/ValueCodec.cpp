@@ -0,0 +1,448 @@
+/**
+ * @file    ValueCodec.cpp
+ * @brief   mbed CoAP Endpoint binary value encoders (LWM2M TLV, CBOR) (implementation)
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ValueCodec.h"
+
+// CBOR major types
+#define CBOR_UNSIGNED   0
+#define CBOR_NEGATIVE   1
+#define CBOR_BYTES      2
+#define CBOR_TEXT       3
+#define CBOR_SIMPLE     7
+
+// CBOR simple values / float markers (additional info)
+#define CBOR_FALSE      20
+#define CBOR_TRUE       21
+#define CBOR_FLOAT16    25
+#define CBOR_FLOAT32    26
+#define CBOR_FLOAT64    27
+
+// float <-> bits without aliasing trouble
+static uint32_t float_to_bits(float value) {
+    uint32_t bits = 0;
+    memcpy(&bits,&value,sizeof(bits));
+    return bits;
+}
+
+static float bits_to_float(uint32_t bits) {
+    float value = 0;
+    memcpy(&value,&bits,sizeof(value));
+    return value;
+}
+
+// IEEE half precision to single
+static float half_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0) {
+        // zero or subnormal
+        float value = (float)mantissa / 16777216.0f;     // 2^-24
+        return (sign != 0) ? -value : value;
+    }
+    if (exponent == 31) return bits_to_float(sign | 0x7F800000 | (mantissa << 13));
+    return bits_to_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+// big endian store/load
+static void put_be(uint64_t value,int length,uint8_t *buffer) {
+    for(int i=length-1;i>=0;--i) {
+        buffer[i] = (uint8_t)(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+static uint64_t get_be(const uint8_t *data,int length) {
+    uint64_t value = 0;
+    for(int i=0;i<length;++i) value = (value << 8) | data[i];
+    return value;
+}
+
+// TLV header
+int ValueCodec::tlvHeader(uint8_t type,uint16_t id,int value_length,uint8_t *buffer,int buffer_length) {
+    if (buffer == NULL || value_length < 0 || value_length > 0xFFFFFF) return -1;
+
+    int id_length = (id > 0xFF) ? 2 : 1;
+    int length_length = 0;
+    if (value_length > 0xFFFF) length_length = 3;
+    else if (value_length > 0xFF) length_length = 2;
+    else if (value_length > 7) length_length = 1;
+
+    int header_length = 1 + id_length + length_length;
+    if (header_length > buffer_length) return -1;
+
+    uint8_t tag = (type & 0xC0);
+    if (id_length == 2) tag |= 0x20;
+    if (length_length == 0) tag |= (uint8_t)value_length;
+    else tag |= (uint8_t)(length_length << 3);
+
+    buffer[0] = tag;
+    put_be(id,id_length,&buffer[1]);
+    if (length_length > 0) put_be((uint64_t)value_length,length_length,&buffer[1+id_length]);
+    return header_length;
+}
+
+// TLV integer
+int ValueCodec::tlvInteger(uint16_t id,int64_t value,uint8_t *buffer,int buffer_length) {
+    int value_length = 8;
+    if (value >= -128 && value <= 127) value_length = 1;
+    else if (value >= -32768 && value <= 32767) value_length = 2;
+    else if (value >= -2147483647LL-1 && value <= 2147483647LL) value_length = 4;
+
+    int header_length = ValueCodec::tlvHeader(TLV_TYPE_RESOURCE,id,value_length,buffer,buffer_length);
+    if (header_length < 0 || header_length + value_length > buffer_length) return -1;
+    put_be((uint64_t)value,value_length,&buffer[header_length]);
+    return header_length + value_length;
+}
+
+// TLV float (single precision)
+int ValueCodec::tlvFloat(uint16_t id,float value,uint8_t *buffer,int buffer_length) {
+    int header_length = ValueCodec::tlvHeader(TLV_TYPE_RESOURCE,id,4,buffer,buffer_length);
+    if (header_length < 0 || header_length + 4 > buffer_length) return -1;
+    put_be(float_to_bits(value),4,&buffer[header_length]);
+    return header_length + 4;
+}
+
+// TLV boolean
+int ValueCodec::tlvBoolean(uint16_t id,bool value,uint8_t *buffer,int buffer_length) {
+    int header_length = ValueCodec::tlvHeader(TLV_TYPE_RESOURCE,id,1,buffer,buffer_length);
+    if (header_length < 0 || header_length + 1 > buffer_length) return -1;
+    buffer[header_length] = value ? 1 : 0;
+    return header_length + 1;
+}
+
+// TLV opaque
+int ValueCodec::tlvOpaque(uint16_t id,const uint8_t *value,int value_length,uint8_t *buffer,int buffer_length) {
+    int header_length = ValueCodec::tlvHeader(TLV_TYPE_RESOURCE,id,value_length,buffer,buffer_length);
+    if (header_length < 0 || header_length + value_length > buffer_length) return -1;
+    if (value_length > 0) memcpy(&buffer[header_length],value,value_length);
+    return header_length + value_length;
+}
+
+// TLV record parse
+int ValueCodec::tlvParse(const uint8_t *data,int data_length,uint8_t *type,uint16_t *id,const uint8_t **value,int *value_length) {
+    if (data == NULL || data_length < 2) return -1;
+
+    uint8_t tag = data[0];
+    int id_length = ((tag & 0x20) != 0) ? 2 : 1;
+    int length_length = (tag >> 3) & 0x03;
+    int header_length = 1 + id_length + length_length;
+    if (header_length > data_length) return -1;
+
+    int length = (length_length == 0) ? (tag & 0x07) : (int)get_be(&data[1+id_length],length_length);
+    if (header_length + length > data_length) return -1;
+
+    if (type != NULL) *type = (tag & 0xC0);
+    if (id != NULL) *id = (uint16_t)get_be(&data[1],id_length);
+    if (value != NULL) *value = &data[header_length];
+    if (value_length != NULL) *value_length = length;
+    return header_length + length;
+}
+
+// TLV integer value
+bool ValueCodec::tlvToInteger(const uint8_t *value,int value_length,int64_t *result) {
+    if (value == NULL || result == NULL) return false;
+    if (value_length != 1 && value_length != 2 && value_length != 4 && value_length != 8) return false;
+    uint64_t raw = get_be(value,value_length);
+    int shift = 64 - (value_length * 8);
+    *result = (shift > 0) ? ((int64_t)(raw << shift) >> shift) : (int64_t)raw;     // sign extend
+    return true;
+}
+
+// TLV float value
+bool ValueCodec::tlvToFloat(const uint8_t *value,int value_length,float *result) {
+    if (value == NULL || result == NULL) return false;
+    if (value_length == 4) {
+        *result = bits_to_float((uint32_t)get_be(value,4));
+        return true;
+    }
+    if (value_length == 8) {
+        uint64_t bits = get_be(value,8);
+        double d = 0;
+        memcpy(&d,&bits,sizeof(d));
+        *result = (float)d;
+        return true;
+    }
+    return false;
+}
+
+// TLV boolean value
+bool ValueCodec::tlvToBoolean(const uint8_t *value,int value_length,bool *result) {
+    if (value == NULL || result == NULL || value_length != 1 || value[0] > 1) return false;
+    *result = (value[0] == 1);
+    return true;
+}
+
+// CBOR header
+int ValueCodec::cborHeader(uint8_t major,uint64_t argument,uint8_t *buffer,int buffer_length) {
+    int extra = 0;
+    uint8_t info = (uint8_t)argument;
+    if (argument > 0xFFFFFFFFULL) { extra = 8; info = 27; }
+    else if (argument > 0xFFFF) { extra = 4; info = 26; }
+    else if (argument > 0xFF) { extra = 2; info = 25; }
+    else if (argument > 23) { extra = 1; info = 24; }
+
+    if (buffer == NULL || 1 + extra > buffer_length) return -1;
+    buffer[0] = (uint8_t)((major << 5) | info);
+    if (extra > 0) put_be(argument,extra,&buffer[1]);
+    return 1 + extra;
+}
+
+// CBOR header parse
+int ValueCodec::cborParseHeader(const uint8_t *data,int data_length,uint8_t *major,uint8_t *info,uint64_t *argument) {
+    if (data == NULL || data_length < 1) return -1;
+    *major = data[0] >> 5;
+    *info = data[0] & 0x1F;
+
+    int extra = 0;
+    if (*info == 24) extra = 1;
+    else if (*info == 25) extra = 2;
+    else if (*info == 26) extra = 4;
+    else if (*info == 27) extra = 8;
+    else if (*info > 27) return -1;                 // indefinite lengths are not supported
+
+    if (1 + extra > data_length) return -1;
+    *argument = (extra > 0) ? get_be(&data[1],extra) : *info;
+    return 1 + extra;
+}
+
+// CBOR integer
+int ValueCodec::cborInteger(int64_t value,uint8_t *buffer,int buffer_length) {
+    if (value < 0) return ValueCodec::cborHeader(CBOR_NEGATIVE,(uint64_t)(-1 - value),buffer,buffer_length);
+    return ValueCodec::cborHeader(CBOR_UNSIGNED,(uint64_t)value,buffer,buffer_length);
+}
+
+// CBOR float (single precision)
+int ValueCodec::cborFloat(float value,uint8_t *buffer,int buffer_length) {
+    if (buffer == NULL || buffer_length < 5) return -1;
+    buffer[0] = (CBOR_SIMPLE << 5) | CBOR_FLOAT32;
+    put_be(float_to_bits(value),4,&buffer[1]);
+    return 5;
+}
+
+// CBOR boolean
+int ValueCodec::cborBoolean(bool value,uint8_t *buffer,int buffer_length) {
+    if (buffer == NULL || buffer_length < 1) return -1;
+    buffer[0] = (CBOR_SIMPLE << 5) | (value ? CBOR_TRUE : CBOR_FALSE);
+    return 1;
+}
+
+// CBOR byte string
+int ValueCodec::cborBytes(const uint8_t *value,int value_length,uint8_t *buffer,int buffer_length) {
+    int header_length = ValueCodec::cborHeader(CBOR_BYTES,(uint64_t)value_length,buffer,buffer_length);
+    if (header_length < 0 || header_length + value_length > buffer_length) return -1;
+    if (value_length > 0) memcpy(&buffer[header_length],value,value_length);
+    return header_length + value_length;
+}
+
+// CBOR text string
+int ValueCodec::cborText(const char *value,int value_length,uint8_t *buffer,int buffer_length) {
+    int header_length = ValueCodec::cborHeader(CBOR_TEXT,(uint64_t)value_length,buffer,buffer_length);
+    if (header_length < 0 || header_length + value_length > buffer_length) return -1;
+    if (value_length > 0) memcpy(&buffer[header_length],value,value_length);
+    return header_length + value_length;
+}
+
+// CBOR array header
+int ValueCodec::cborArray(int count,uint8_t *buffer,int buffer_length) {
+    return ValueCodec::cborHeader(4,(uint64_t)count,buffer,buffer_length);
+}
+
+// CBOR map header
+int ValueCodec::cborMap(int count,uint8_t *buffer,int buffer_length) {
+    return ValueCodec::cborHeader(5,(uint64_t)count,buffer,buffer_length);
+}
+
+// CBOR integer item
+bool ValueCodec::cborToInteger(const uint8_t *data,int data_length,int64_t *result) {
+    uint8_t major = 0;
+    uint8_t info = 0;
+    uint64_t argument = 0;
+    if (result == NULL || ValueCodec::cborParseHeader(data,data_length,&major,&info,&argument) < 0) return false;
+    if (argument > 0x7FFFFFFFFFFFFFFFULL) return false;
+    if (major == CBOR_UNSIGNED) { *result = (int64_t)argument; return true; }
+    if (major == CBOR_NEGATIVE) { *result = -1 - (int64_t)argument; return true; }
+    return false;
+}
+
+// CBOR float item (integers are accepted too)
+bool ValueCodec::cborToFloat(const uint8_t *data,int data_length,float *result) {
+    uint8_t major = 0;
+    uint8_t info = 0;
+    uint64_t argument = 0;
+    if (result == NULL || ValueCodec::cborParseHeader(data,data_length,&major,&info,&argument) < 0) return false;
+    if (major == CBOR_SIMPLE) {
+        if (info == CBOR_FLOAT16) { *result = half_to_float((uint16_t)argument); return true; }
+        if (info == CBOR_FLOAT32) { *result = bits_to_float((uint32_t)argument); return true; }
+        if (info == CBOR_FLOAT64) {
+            double d = 0;
+            memcpy(&d,&argument,sizeof(d));
+            *result = (float)d;
+            return true;
+        }
+        return false;
+    }
+    int64_t integer = 0;
+    if (ValueCodec::cborToInteger(data,data_length,&integer)) {
+        *result = (float)integer;
+        return true;
+    }
+    return false;
+}
+
+// CBOR boolean item
+bool ValueCodec::cborToBoolean(const uint8_t *data,int data_length,bool *result) {
+    if (data == NULL || result == NULL || data_length < 1) return false;
+    if (data[0] == ((CBOR_SIMPLE << 5) | CBOR_TRUE)) { *result = true; return true; }
+    if (data[0] == ((CBOR_SIMPLE << 5) | CBOR_FALSE)) { *result = false; return true; }
+    return false;
+}
+
+// CBOR byte (or text) string item
+bool ValueCodec::cborToBytes(const uint8_t *data,int data_length,const uint8_t **value,int *value_length) {
+    uint8_t major = 0;
+    uint8_t info = 0;
+    uint64_t argument = 0;
+    int header_length = ValueCodec::cborParseHeader(data,data_length,&major,&info,&argument);
+    if (header_length < 0 || (major != CBOR_BYTES && major != CBOR_TEXT)) return false;
+    if (argument > (uint64_t)(data_length - header_length)) return false;
+    if (value != NULL) *value = &data[header_length];
+    if (value_length != NULL) *value_length = (int)argument;
+    return true;
+}
+
+// fixed point text
+int ValueCodec::textFixed(float value,int decimals,char *buffer,int buffer_length) {
+    if (buffer == NULL || buffer_length < 2) return -1;
+    if (decimals < 0) decimals = 0;
+    if (decimals > 6) decimals = 6;
+
+    int64_t scale = 1;
+    for(int i=0;i<decimals;++i) scale *= 10;
+
+    bool negative = (value < 0);
+    float magnitude = negative ? -value : value;
+    if (magnitude * scale > 9.0e17f) return -1;
+    int64_t scaled = (int64_t)(magnitude * scale + 0.5f);
+
+    // integer part
+    char digits[24];
+    int n = ValueCodec::textInteger(scaled / scale,digits,sizeof(digits));
+    int length = n + (negative ? 1 : 0) + ((decimals > 0) ? decimals + 1 : 0);
+    if (n < 0 || length + 1 > buffer_length) return -1;
+
+    int pos = 0;
+    if (negative) buffer[pos++] = '-';
+    memcpy(&buffer[pos],digits,n);
+    pos += n;
+
+    // fraction
+    if (decimals > 0) {
+        int64_t fraction = scaled % scale;
+        buffer[pos++] = '.';
+        for(int i=decimals-1;i>=0;--i) {
+            buffer[pos+i] = (char)('0' + (fraction % 10));
+            fraction /= 10;
+        }
+        pos += decimals;
+    }
+    buffer[pos] = '\0';
+    return pos;
+}
+
+// integer text
+int ValueCodec::textInteger(int64_t value,char *buffer,int buffer_length) {
+    char digits[21];
+    int n = 0;
+    uint64_t magnitude = (value < 0) ? (uint64_t)(-(value + 1)) + 1 : (uint64_t)value;
+    do {
+        digits[n++] = (char)('0' + (magnitude % 10));
+        magnitude /= 10;
+    } while(magnitude > 0);
+
+    int length = n + ((value < 0) ? 1 : 0);
+    if (buffer == NULL || length + 1 > buffer_length) return -1;
+
+    int pos = 0;
+    if (value < 0) buffer[pos++] = '-';
+    while(n > 0) buffer[pos++] = digits[--n];
+    buffer[pos] = '\0';
+    return pos;
+}
+
+// literal text
+int ValueCodec::literal(const char *text,uint8_t *buffer,int buffer_length) {
+    int length = strlen(text);
+    if (buffer == NULL || length > buffer_length) return -1;
+    memcpy(buffer,text,length);
+    return length;
+}
+
+// JSON string
+int ValueCodec::jsonString(const char *value,int value_length,uint8_t *buffer,int buffer_length) {
+    static const char hex[] = "0123456789abcdef";
+    if (buffer == NULL || buffer_length < 2) return -1;
+    int pos = 0;
+    buffer[pos++] = '"';
+    for(int i=0;i<value_length;++i) {
+        uint8_t c = (uint8_t)value[i];
+        if (c == '"' || c == '\\') {
+            if (pos + 2 > buffer_length) return -1;
+            buffer[pos++] = '\\';
+            buffer[pos++] = c;
+        }
+        else if (c < 0x20) {
+            if (pos + 6 > buffer_length) return -1;
+            buffer[pos++] = '\\';
+            buffer[pos++] = 'u';
+            buffer[pos++] = '0';
+            buffer[pos++] = '0';
+            buffer[pos++] = hex[c >> 4];
+            buffer[pos++] = hex[c & 0x0F];
+        }
+        else {
+            if (pos + 1 > buffer_length) return -1;
+            buffer[pos++] = c;
+        }
+    }
+    if (pos + 1 > buffer_length) return -1;
+    buffer[pos++] = '"';
+    return pos;
+}
+
+// base64url (no padding)
+int ValueCodec::base64url(const uint8_t *value,int value_length,uint8_t *buffer,int buffer_length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    int length = (value_length * 4 + 2) / 3;
+    if (buffer == NULL || length > buffer_length) return -1;
+    int pos = 0;
+    for(int i=0;i<value_length;i+=3) {
+        uint32_t group = (uint32_t)value[i] << 16;
+        if (i + 1 < value_length) group |= (uint32_t)value[i+1] << 8;
+        if (i + 2 < value_length) group |= value[i+2];
+        buffer[pos++] = alphabet[(group >> 18) & 0x3F];
+        buffer[pos++] = alphabet[(group >> 12) & 0x3F];
+        if (i + 1 < value_length) buffer[pos++] = alphabet[(group >> 6) & 0x3F];
+        if (i + 2 < value_length) buffer[pos++] = alphabet[group & 0x3F];
+    }
+    return pos;
+}
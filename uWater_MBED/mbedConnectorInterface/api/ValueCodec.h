@@ -0,0 +1,154 @@
+/**
+ * @file    ValueCodec.h
+ * @brief   mbed CoAP Endpoint binary value encoders (LWM2M TLV, CBOR) (header)
+ * @author  uWater team
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) 2014
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __VALUE_CODEC_H__
+#define __VALUE_CODEC_H__
+
+// mbed support
+#include "mbed.h"
+
+// CoAP Content-Format IDs used by the typed resources
+#define CONTENT_FORMAT_TEXT_PLAIN      0                                      // text/plain
+#define CONTENT_FORMAT_OCTET_STREAM    42                                     // application/octet-stream
+#define CONTENT_FORMAT_CBOR            60                                     // application/cbor
+#define CONTENT_FORMAT_SENML_JSON      110                                    // application/senml+json
+#define CONTENT_FORMAT_SENML_CBOR      112                                    // application/senml+cbor
+#define CONTENT_FORMAT_LWM2M_TLV       11542                                  // application/vnd.oma.lwm2m+tlv
+
+// SenML CBOR labels (RFC 8428)
+#define SENML_LABEL_BASE_NAME          -2
+#define SENML_LABEL_NAME               0
+#define SENML_LABEL_VALUE              2
+#define SENML_LABEL_STRING_VALUE       3
+#define SENML_LABEL_BOOLEAN_VALUE      4
+#define SENML_LABEL_DATA_VALUE         8
+
+// LWM2M TLV identifier types
+#define TLV_TYPE_OBJECT_INSTANCE       0x00
+#define TLV_TYPE_RESOURCE_INSTANCE     0x40
+#define TLV_TYPE_MULTIPLE_RESOURCE     0x80
+#define TLV_TYPE_RESOURCE              0xC0
+
+/**
+ ValueCodec encodes and decodes single resource values directly into caller supplied
+ buffers - no intermediate strings and no printf/scanf. All encoders return the number
+ of bytes written or -1 if the buffer is too small; all decoders return true on success.
+ */
+class ValueCodec {
+    public:
+        /**
+        Write an LWM2M TLV header
+        @param type input the identifier type (TLV_TYPE_*)
+        @param id input the identifier
+        @param value_length input the length of the value that follows
+        @param buffer output the buffer
+        @param buffer_length input the buffer length
+        @return bytes written or -1
+        */
+        static int tlvHeader(uint8_t type,uint16_t id,int value_length,uint8_t *buffer,int buffer_length);
+
+        /**
+        LWM2M TLV resource encoders (integers use the shortest of 1/2/4/8 bytes)
+        */
+        static int tlvInteger(uint16_t id,int64_t value,uint8_t *buffer,int buffer_length);
+        static int tlvFloat(uint16_t id,float value,uint8_t *buffer,int buffer_length);
+        static int tlvBoolean(uint16_t id,bool value,uint8_t *buffer,int buffer_length);
+        static int tlvOpaque(uint16_t id,const uint8_t *value,int value_length,uint8_t *buffer,int buffer_length);
+
+        /**
+        Parse one LWM2M TLV record
+        @param data input the TLV data
+        @param data_length input the TLV data length
+        @param type output the identifier type
+        @param id output the identifier
+        @param value output pointer to the value (within data)
+        @param value_length output the value length
+        @return bytes consumed or -1 if malformed
+        */
+        static int tlvParse(const uint8_t *data,int data_length,uint8_t *type,uint16_t *id,const uint8_t **value,int *value_length);
+
+        /**
+        LWM2M TLV value decoders (value as returned by tlvParse())
+        */
+        static bool tlvToInteger(const uint8_t *value,int value_length,int64_t *result);
+        static bool tlvToFloat(const uint8_t *value,int value_length,float *result);
+        static bool tlvToBoolean(const uint8_t *value,int value_length,bool *result);
+
+        /**
+        CBOR item encoders
+        */
+        static int cborInteger(int64_t value,uint8_t *buffer,int buffer_length);
+        static int cborFloat(float value,uint8_t *buffer,int buffer_length);
+        static int cborBoolean(bool value,uint8_t *buffer,int buffer_length);
+        static int cborBytes(const uint8_t *value,int value_length,uint8_t *buffer,int buffer_length);
+        static int cborText(const char *value,int value_length,uint8_t *buffer,int buffer_length);
+        static int cborArray(int count,uint8_t *buffer,int buffer_length);
+        static int cborMap(int count,uint8_t *buffer,int buffer_length);
+
+        /**
+        CBOR item decoders (single item at the start of data)
+        */
+        static bool cborToInteger(const uint8_t *data,int data_length,int64_t *result);
+        static bool cborToFloat(const uint8_t *data,int data_length,float *result);
+        static bool cborToBoolean(const uint8_t *data,int data_length,bool *result);
+        static bool cborToBytes(const uint8_t *data,int data_length,const uint8_t **value,int *value_length);
+
+        /**
+        Format a float as fixed point text without printf
+        @param value input the value
+        @param decimals input digits after the decimal point (0-6)
+        @param buffer output the buffer (NULL terminated)
+        @param buffer_length input the buffer length
+        @return characters written (excluding the NULL) or -1
+        */
+        static int textFixed(float value,int decimals,char *buffer,int buffer_length);
+
+        /**
+        Format an integer as text without printf
+        */
+        static int textInteger(int64_t value,char *buffer,int buffer_length);
+
+        /**
+        Copy literal text (no NULL) into a buffer
+        @return characters written or -1
+        */
+        static int literal(const char *text,uint8_t *buffer,int buffer_length);
+
+        /**
+        Write a quoted, escaped JSON string
+        @return characters written or -1
+        */
+        static int jsonString(const char *value,int value_length,uint8_t *buffer,int buffer_length);
+
+        /**
+        Write base64url (no padding) text, as used for SenML data values
+        @return characters written or -1
+        */
+        static int base64url(const uint8_t *value,int value_length,uint8_t *buffer,int buffer_length);
+
+    private:
+        // CBOR major type + argument
+        static int cborHeader(uint8_t major,uint64_t argument,uint8_t *buffer,int buffer_length);
+        static int cborParseHeader(const uint8_t *data,int data_length,uint8_t *major,uint8_t *info,uint64_t *argument);
+};
+
+#endif // __VALUE_CODEC_H__
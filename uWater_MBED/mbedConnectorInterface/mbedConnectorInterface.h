@@ -32,9 +32,23 @@
 #define NSP_COAP_UDP_PORT        5683                                        // Default CoAP UDP port
 #define NSP_LIFE_TIME_LENGTH     24                                          // length of the lifetime buffer string
 #define NSP_LIFE_TIME            "120"                                       // liftime buffer (representing seconds)
-#define NSP_RD_UPDATE_PERIOD     30000                                       // (in ms) - 30 seconds (1/4 of NSP_LIFE_TIME seconds)
+#define NSP_RD_UPDATE_PERIOD     30000                                       // (in ms) - 30 seconds (legacy fixed re-registration period, see NSP_RD_* below)
+#define NSP_RD_TICK_PERIOD       1000                                        // (in ms) - how often the registration manager checks its deadlines
+#define NSP_RD_UPDATE_MARGIN     10000                                       // (in ms) - minimum lead of a registration update before the lifetime expires (lifetime/8 if larger)
+#define NSP_RD_IDLE_PERIOD       300000                                      // (in ms) - 5 minutes without NSP traffic before an early update is used as a liveness probe
+#define NSP_RD_RESPONSE_TIMEOUT  10000                                       // (in ms) - registration/update without a response is treated as failed
+#define NSP_RD_RETRY_MIN         2000                                        // (in ms) - first retry after a failed registration/update (doubles each failure)
+#define NSP_RD_RETRY_MAX         300000                                      // (in ms) - 5 minutes: retry backoff ceiling
 #define NSP_TICKERUPDATE_PERIOD  30.0                                        // (float secs) - 30 seconds (used for Ticker-based re-registration periods)
 #define NSP_DEFAULT_OBS_PERIOD   10000                                       // (in ms) - 10 seconds between observations..
+#define NSP_BLOCK_SIZE           512                                         // CoAP block-wise transfer block size (16-1024, power of 2)
+
+// NSDL event loop Configuration
+#define NSDL_EVENT_QUEUE_LENGTH  8                                           // work items other threads may have queued for the NSDL event loop (power of 2)
+#define NSDL_EVENT_LATENCY       50                                          // (in ms) - longest a queued event waits while the loop is idle
+#define NSDL_EXEC_IDLE_PERIOD    10000                                       // (in ms) - sn_nsdl_exec() period with no confirmables outstanding (1 s otherwise)
+#define NSDL_MAX_PENDING_CON     4                                           // outstanding confirmables tracked for retransmission servicing
+#define NSDL_CON_EXCHANGE_WINDOW 93000                                       // (in ms) - CoAP MAX_TRANSMIT_WAIT: an unacknowledged confirmable is given up after this
 
 // 6LowPAN Configuration
 #define NODE_MAC_ADDRESS_LENGTH  8
@@ -43,6 +57,10 @@
 
 // DynamicResource Configuration
 #define MAX_VALUE_BUFFER_LENGTH  128                                         // largest "value" a dynamic resource may assume as a string
+#define MAX_PAYLOAD_BUFFER_LENGTH 256                                        // largest encoded (binary or batched) GET payload
+
+// CompositeResource Configuration
+#define COMPOSITE_MAX_MEMBERS    8                                           // maximum number of resources in one object-level/composite read (at most 32)
 
 // Instance Pointer Table Configuration
 #define IPT_MAX_ENTRIES          5                                           // maximum number of unique pointers managed by the IPT (i.e. number of independent dynamic resources)
@@ -50,6 +68,10 @@
 // Logger buffer size
 #define LOGGER_BUFFER_LENGTH     300                                         // largest single print of a given debug line
 
+// HwCrc Configuration
+#define HW_CRC_DMA_THRESHOLD     256                                         // buffers at least this long are fed to the CRC module by eDMA
+#define HW_CRC_DMA_CHANNEL       15                                          // eDMA channel used for the CRC feed (software started)
+
 // 802.15.4 Network ID and RF channel defaults
 #define MESH_NETWORK_ID_LENGTH   32
 #define MESH_DEF_NETWORK_ID      "Network000000000"
@@ -24,6 +24,68 @@ uint8_t null_ep_type[] = "";
 uint8_t null_lifetime_ptr[] = "";
 bool endpoint_registered = false;
 
+// registration manager state: the registration is refreshed shortly before its lifetime expires,
+// NSP traffic stands in for liveness probes, failures back off exponentially and a 4.04 on
+// update (the NSP no longer knows us) forces a full registration
+typedef enum {
+    RD_UNREGISTERED,
+    RD_REGISTERING,
+    RD_REGISTERED,
+    RD_UPDATING
+} rd_state_e;
+
+static volatile rd_state_e rd_state = RD_UNREGISTERED;
+static volatile uint8_t rd_response = 0;                        // response code of our last registration/update (rx_cb)
+static volatile bool rd_traffic = false;                        // NSP traffic received since the last tick (event loop)
+static uint32_t rd_deadline = 0;                                // lifetime expiry of the current registration
+static uint32_t rd_next_action = 0;                             // update due/retry/response timeout
+static uint32_t rd_last_alive = 0;                              // last evidence that the NSP has us
+static uint32_t rd_backoff = 0;                                 // current retry backoff (0: no failures)
+static uint32_t rd_sent_updates = 0;
+static uint32_t rd_sent_registrations = 0;
+
+// NSDL event loop clock
+static Timer nsdl_clock;
+static uint32_t nsdl_clock_base = 0;
+
+// event queue: work posted by other threads (and interrupts), run in the NSDL event loop - the only
+// caller of libnsdl. Lock-free bounded queue: producers claim a slot by compare-and-swap on the tail
+// and publish it through the slot sequence number; the event loop is the single consumer.
+typedef struct {
+    volatile uint32_t sequence;                                 // kept less the slot index, so the zeroed queue is ready
+    nsdl_event_handler_t handler;
+    void *arg;
+} nsdl_event_s;
+
+#if (NSDL_EVENT_QUEUE_LENGTH & (NSDL_EVENT_QUEUE_LENGTH - 1)) != 0
+    #error NSDL_EVENT_QUEUE_LENGTH must be a power of 2
+#endif
+
+static nsdl_event_s nsdl_events[NSDL_EVENT_QUEUE_LENGTH];
+static volatile uint32_t nsdl_event_tail = 0;                   // next slot to claim (producers)
+static uint32_t nsdl_event_head = 0;                            // next slot to run (event loop)
+static volatile uint32_t nsdl_events_dropped = 0;
+
+// confirmable messages we sent that are not yet acknowledged (libnsdl keeps its retransmission queue private)
+typedef struct {
+    uint16_t msg_id;
+    uint32_t sent;
+} nsdl_pending_con_s;
+
+static nsdl_pending_con_s nsdl_pending_cons[NSDL_MAX_PENDING_CON];
+static int nsdl_num_pending_cons = 0;
+
+// milliseconds since start (the mbed Timer itself wraps after ~35 minutes)
+static uint32_t nsdl_now(void) {
+    int elapsed = nsdl_clock.read_ms();
+    if (elapsed >= 600000) {
+        nsdl_clock_base += elapsed;
+        nsdl_clock.reset();
+        elapsed = 0;
+    }
+    return nsdl_clock_base + elapsed;
+}
+
 void *nsdl_alloc(uint16_t size) {
     void *chunk = NULL;
     if (size > 0) chunk = malloc(size);
@@ -96,40 +158,118 @@ void nsdl_clean_register_endpoint(sn_nsdl_ep_parameters_s **endpoint_structure)
     }
 }
 
+// CoAP header: type and message ID
+#define COAP_HEADER_TYPE(data)      (((data)[0] >> 4) & 0x03)
+#define COAP_HEADER_MSG_ID(data)    ((uint16_t)(((data)[2] << 8) | (data)[3]))
+#define COAP_TYPE_CON               0
+#define COAP_TYPE_ACK               2
+#define COAP_TYPE_RST               3
+
+// remember an outgoing confirmable (a retransmission is already known)
+static void nsdl_track_con(uint16_t msg_id,uint32_t now) {
+    int oldest = 0;
+    for(int i=0;i<nsdl_num_pending_cons;++i) {
+        if (nsdl_pending_cons[i].msg_id == msg_id) return;
+        if ((int32_t)(nsdl_pending_cons[i].sent - nsdl_pending_cons[oldest].sent) < 0) oldest = i;
+    }
+    if (nsdl_num_pending_cons < NSDL_MAX_PENDING_CON) oldest = nsdl_num_pending_cons++;
+    nsdl_pending_cons[oldest].msg_id = msg_id;
+    nsdl_pending_cons[oldest].sent = now;
+}
+
+// forget acknowledged (or reset) confirmables and those past the CoAP exchange window
+static void nsdl_release_con(int msg_id,uint32_t now) {
+    int i = 0;
+    while(i < nsdl_num_pending_cons) {
+        if (nsdl_pending_cons[i].msg_id == msg_id || (int32_t)(now - nsdl_pending_cons[i].sent) >= NSDL_CON_EXCHANGE_WINDOW) {
+            nsdl_pending_cons[i] = nsdl_pending_cons[--nsdl_num_pending_cons];
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
 static uint8_t tx_cb(sn_nsdl_capab_e protocol, uint8_t *data_ptr, uint16_t data_len, sn_nsdl_addr_s *address_ptr) {
     //DBG("NSP: sending %d bytes...\r\n",data_len);
     int sent = server.sendTo(nsp, (char*)data_ptr, data_len);
+    if (data_len >= 4 && COAP_HEADER_TYPE(data_ptr) == COAP_TYPE_CON) nsdl_track_con(COAP_HEADER_MSG_ID(data_ptr),nsdl_now());
     return 1;
 }
 
 static uint8_t rx_cb(sn_coap_hdr_s *coap_packet_ptr, sn_nsdl_addr_s *address_ptr) {
     // Rx callback process it...
     //DBG("NSP: received data. processing...\r\n");
+    
+    // replies to our registration/update are handed to the registration manager
+    if (coap_packet_ptr != NULL && (rd_state == RD_REGISTERING || rd_state == RD_UPDATING) && coap_packet_ptr->msg_code >= COAP_MSG_CODE_RESPONSE_CREATED) {
+        rd_response = (uint8_t)coap_packet_ptr->msg_code;
+    }
     return 0;
 }
 
+// registration lifetime in ms
+static uint32_t rd_lifetime(void) {
+    int lifetime = atoi((char *)lifetime_ptr);
+    if (lifetime <= 0) lifetime = atoi(NSP_LIFE_TIME);
+    return (uint32_t)lifetime * 1000;
+}
+
+// when the next update is due: ahead of the lifetime deadline by lifetime/8 (at least NSP_RD_UPDATE_MARGIN)
+static uint32_t rd_update_due(uint32_t now) {
+    uint32_t lifetime = rd_lifetime();
+    uint32_t margin = lifetime / 8;
+    if (margin < NSP_RD_UPDATE_MARGIN) margin = NSP_RD_UPDATE_MARGIN;
+    if (margin >= lifetime) margin = lifetime / 2;
+    return now + lifetime - margin;
+}
+
+// failed registration/update: exponential backoff with jitter (spreads a fleet recovering from an NSP outage)
+static void rd_failed(uint32_t now) {
+    if (rd_backoff == 0) rd_backoff = NSP_RD_RETRY_MIN;
+    else if (rd_backoff < NSP_RD_RETRY_MAX / 2) rd_backoff *= 2;
+    else rd_backoff = NSP_RD_RETRY_MAX;
+    rd_next_action = now + rd_backoff - (rand() % (rd_backoff / 4 + 1));
+    
+    // an update may still be retried while the current registration lasts
+    if (rd_state == RD_UPDATING && (int32_t)(rd_deadline - rd_next_action) > 0) {
+        rd_state = RD_REGISTERED;
+    }
+    else {
+        rd_state = RD_UNREGISTERED;
+        endpoint_registered = false;
+    }
+    DBG("NSP: %s failed, retrying in %d ms\r\n",(rd_state == RD_REGISTERED) ? "registration update" : "registration",(int)(rd_next_action - now));
+}
+
 void register_endpoint(bool init) {
     sn_nsdl_ep_parameters_s *endpoint_ptr = NULL;
+    uint32_t now = nsdl_now();
+    rd_response = 0;
     if (init) {
+        rd_state = RD_REGISTERING;
+        ++rd_sent_registrations;
         endpoint_ptr = nsdl_init_register_endpoint(endpoint_ptr, (uint8_t *)domain_name, (uint8_t*)endpoint_name, ep_type, lifetime_ptr);
         if(sn_nsdl_register_endpoint(endpoint_ptr) != 0) {
             DBG("NSP initial registration failed\r\n");
-            endpoint_registered = false;
+            rd_failed(now);
         }
         else {
-            //DBG("NSP initial registration OK\r\n");
-            endpoint_registered = true;
+            //DBG("NSP initial registration sent\r\n");
+            rd_next_action = now + NSP_RD_RESPONSE_TIMEOUT;
         }
     }
     else {
+        rd_state = RD_UPDATING;
+        ++rd_sent_updates;
         endpoint_ptr = nsdl_init_register_endpoint(endpoint_ptr, (uint8_t *)null_domain, (uint8_t*)null_endpoint_name, null_ep_type, null_lifetime_ptr);
         if(sn_nsdl_update_registration(endpoint_ptr) != 0) {
             DBG("NSP re-registration failed\r\n");
-            endpoint_registered = false;
+            rd_failed(now);
         }
         else {
-            //DBG("NSP re-registration OK\r\n");
-            endpoint_registered = true;
+            //DBG("NSP re-registration sent\r\n");
+            rd_next_action = now + NSP_RD_RESPONSE_TIMEOUT;
         }
     }
     nsdl_clean_register_endpoint(&endpoint_ptr);
@@ -139,10 +279,155 @@ bool nsdl_endpoint_is_registered(void) {
     return endpoint_registered;
 }
 
-void registration_update_thread(void const *args) {    
+// NSP traffic received: the NSP still routes to us, so no separate liveness probe is needed
+void nsdl_registration_alive(void) {
+    rd_traffic = true;
+}
+
+// registration manager: acts only when a deadline is reached or a response arrived
+void nsdl_registration_tick(void) {
+    uint32_t now = nsdl_now();
+    uint8_t response = rd_response;
+    bool traffic = rd_traffic;
+    rd_traffic = false;
+    if (traffic) rd_last_alive = now;
+    
+    switch(rd_state) {
+        case RD_REGISTERING:
+        case RD_UPDATING:
+            if (response == COAP_MSG_CODE_RESPONSE_CREATED || response == COAP_MSG_CODE_RESPONSE_CHANGED) {
+                // (re)registered: a fresh lifetime starts now
+                rd_response = 0;
+                rd_state = RD_REGISTERED;
+                rd_deadline = now + rd_lifetime();
+                rd_next_action = rd_update_due(now);
+                rd_last_alive = now;
+                rd_backoff = 0;
+                endpoint_registered = true;
+            }
+            else if (response == COAP_MSG_CODE_RESPONSE_NOT_FOUND && rd_state == RD_UPDATING) {
+                // the NSP has dropped our registration: register from scratch right away
+                DBG("NSP: registration unknown to the NSP (4.04), re-registering\r\n");
+                rd_response = 0;
+                rd_state = RD_UNREGISTERED;
+                rd_next_action = now;
+                endpoint_registered = false;
+                register_endpoint(true);
+            }
+            else if (response != 0 || (int32_t)(now - rd_next_action) >= 0) {
+                // error response or no response at all
+                rd_response = 0;
+                rd_failed(now);
+            }
+            break;
+            
+        case RD_REGISTERED:
+            if ((int32_t)(now - rd_deadline) >= 0) {
+                // lifetime lapsed without a successful update
+                rd_state = RD_UNREGISTERED;
+                endpoint_registered = false;
+                register_endpoint(true);
+            }
+            else if (traffic && rd_backoff != 0) {
+                // retrying a failed update and the NSP is reachable again: retry now
+                register_endpoint(false);
+            }
+            else if ((int32_t)(now - rd_next_action) >= 0 || (int32_t)(now - rd_last_alive) >= NSP_RD_IDLE_PERIOD) {
+                // update due before the lifetime ends, or quiet for too long (doubles as a liveness probe)
+                register_endpoint(false);
+            }
+            break;
+            
+        case RD_UNREGISTERED:
+        default:
+            if ((int32_t)(now - rd_next_action) >= 0) register_endpoint(true);
+            break;
+    }
+}
+
+// registration counters (sent since start)
+void nsdl_registration_counts(uint32_t *registrations,uint32_t *updates) {
+    if (registrations != NULL) *registrations = rd_sent_registrations;
+    if (updates != NULL) *updates = rd_sent_updates;
+}
+
+// atomic compare-and-swap (LDREX/STREX on Cortex-M3/M4)
+static bool nsdl_compare_and_swap(volatile uint32_t *ptr,uint32_t expected,uint32_t desired) {
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+    do {
+        if (__LDREXW(ptr) != expected) {
+            __CLREX();
+            return false;
+        }
+    } while(__STREXW(desired,ptr) != 0);
+    __DMB();
+    return true;
+#else
+    return __sync_bool_compare_and_swap(ptr,expected,desired);
+#endif
+}
+
+static void nsdl_memory_barrier(void) {
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+    __DMB();
+#else
+    __sync_synchronize();
+#endif
+}
+
+// post work to the NSDL event loop (any thread or interrupt - never blocks)
+bool nsdl_post_event(nsdl_event_handler_t handler,void *arg) {
+    if (handler == NULL) return false;
+    
+    // claim a slot
+    uint32_t position = nsdl_event_tail;
+    nsdl_event_s *event = NULL;
+    uint32_t slot = 0;
     while(true) {
-        Thread::wait(NSP_RD_UPDATE_PERIOD);
-        register_endpoint(false);
+        slot = position & (NSDL_EVENT_QUEUE_LENGTH - 1);
+        event = &nsdl_events[slot];
+        int32_t difference = (int32_t)(event->sequence + slot - position);
+        if (difference == 0) {
+            if (nsdl_compare_and_swap(&nsdl_event_tail,position,position + 1)) break;
+        }
+        else if (difference < 0) {
+            // full: the event loop has not yet run the slot from one lap ago
+            ++nsdl_events_dropped;
+            return false;
+        }
+        position = nsdl_event_tail;
+    }
+    
+    // fill and publish it
+    event->handler = handler;
+    event->arg = arg;
+    nsdl_memory_barrier();
+    event->sequence = position + 1 - slot;
+    return true;
+}
+
+// events dropped because the queue was full
+uint32_t nsdl_dropped_events(void) {
+    return nsdl_events_dropped;
+}
+
+// run the posted events (event loop only)
+static void nsdl_run_events(void) {
+    while(true) {
+        uint32_t slot = nsdl_event_head & (NSDL_EVENT_QUEUE_LENGTH - 1);
+        nsdl_event_s *event = &nsdl_events[slot];
+        
+        // empty, or the next producer has not published yet (picked up on the next pass)
+        if (event->sequence + slot != nsdl_event_head + 1) return;
+        nsdl_memory_barrier();
+        nsdl_event_handler_t handler = event->handler;
+        void *arg = event->arg;
+        nsdl_memory_barrier();
+        
+        // release the slot for the next lap before running: handlers may post again
+        event->sequence = nsdl_event_head + NSDL_EVENT_QUEUE_LENGTH - slot;
+        ++nsdl_event_head;
+        handler(arg);
     }
 }
 
@@ -153,6 +438,9 @@ void nsdl_init() {
     server.init();
     server.bind(nsp_port);
     
+    // event loop clock
+    nsdl_clock.start();
+    
     /* Initialize libNsdl */
     memset(&memory_cbs,0,sizeof(memory_cbs));
     memory_cbs.sn_nsdl_alloc = &nsdl_alloc;
@@ -163,6 +451,11 @@ void nsdl_init() {
     else {
         DBG("NSP: libNsdl init successful.\r\n");
     }
+    
+    // block-wise transfers: the library and our streamed resources use the same block size
+    if (sn_coap_protocol_set_block_size(NSP_BLOCK_SIZE) != 0) {
+        DBG("NSP: libNsdl block-wise transfer not available (block size %d unchanged).\r\n",NSP_BLOCK_SIZE);
+    }
 }
 
 void nsdl_set_nsp_address(void) {
@@ -175,26 +468,61 @@ void nsdl_set_nsp_address(void) {
     nsp.set_address(NSP_address_str,nsp_port);
 }
 
-// NSP event loop - spawn a re-registration thread AFTER we have initially registered and begun event processing...     
+// NSP event loop - single owner of libnsdl: receives with a timeout bounded by the next deadline
+// (libnsdl retransmissions, registration manager) and runs events posted by other threads
 void nsdl_event_loop() {    
     sn_nsdl_addr_s received_packet_address; 
     Endpoint from;
     uint8_t nsp_received_address[4];
     char nsp_buffer[1024];
+    uint32_t now = nsdl_now();
+    uint32_t next_exec = now + NSDL_EXEC_IDLE_PERIOD;
+    uint32_t next_rd_tick = now + NSP_RD_TICK_PERIOD;
 
     memset(&received_packet_address, 0, sizeof(sn_nsdl_addr_s));
     memset(nsp_received_address, 0, sizeof(nsp_received_address));
     received_packet_address.addr_ptr = nsp_received_address;    
-            
-    // start the registration update thread.. it will wait a bit while the endpoint gins up...
-    Thread registration_thread(registration_update_thread);
     
     // FOREVER: main loop for event processing  
     while(true) {        
+        // wait no longer than the next deadline (and the event latency bound)
+        int32_t wait = (int32_t)(next_exec - now);
+        if ((int32_t)(next_rd_tick - now) < wait) wait = (int32_t)(next_rd_tick - now);
+        if (wait > NSDL_EVENT_LATENCY) wait = NSDL_EVENT_LATENCY;
+        if (wait < 0) wait = 0;
+        
         //DBG("NSP: waiting for data...\r\n");
+        server.set_blocking(false,(unsigned int)wait);
         int n = server.receiveFrom(from,nsp_buffer,sizeof(nsp_buffer));
+        now = nsdl_now();
 
         //DBG("NSP: received %d bytes... processing..\r\n.",n);
-        if (n >= 0) sn_nsdl_process_coap((uint8_t*)nsp_buffer,n,&received_packet_address);        
-     }
+        if (n > 0) {
+            if (n >= 4 && (COAP_HEADER_TYPE((uint8_t*)nsp_buffer) == COAP_TYPE_ACK || COAP_HEADER_TYPE((uint8_t*)nsp_buffer) == COAP_TYPE_RST)) {
+                nsdl_release_con(COAP_HEADER_MSG_ID((uint8_t*)nsp_buffer),now);
+            }
+            nsdl_registration_alive();
+            sn_nsdl_process_coap((uint8_t*)nsp_buffer,n,&received_packet_address);        
+        }
+        
+        // work from other threads
+        nsdl_run_events();
+        
+        // libnsdl timers: every second while confirmables are outstanding, otherwise only to age the duplicate cache
+        if ((int32_t)(now - next_exec) >= 0) {
+            sn_nsdl_exec(now / 1000);
+            nsdl_release_con(-1,now);
+            next_exec = now + ((nsdl_num_pending_cons > 0) ? 1000 : NSDL_EXEC_IDLE_PERIOD);
+        }
+        else if (nsdl_num_pending_cons > 0 && (int32_t)(next_exec - now) > 1000) {
+            // a confirmable went out since: its retransmission timer needs servicing
+            next_exec = now + 1000;
+        }
+        
+        // registration manager
+        if ((int32_t)(now - next_rd_tick) >= 0) {
+            nsdl_registration_tick();
+            next_rd_tick = now + NSP_RD_TICK_PERIOD;
+        }
+    }
 }
\ No newline at end of file
@@ -29,6 +29,7 @@ extern uint8_t lifetime_ptr[NSP_LIFE_TIME_LENGTH];          // MDS lifetime
 
 typedef uint8_t (*sn_grs_dyn_res_callback_t)(sn_coap_hdr_s *, sn_nsdl_addr_s *, sn_proto_info_s *);
 typedef void (*sn_update_observation_t)(sn_coap_hdr_s *,sn_coap_hdr_s *);
+typedef void (*nsdl_event_handler_t)(void *arg);
 
 // external methods
 extern "C" void *nsdl_alloc(uint16_t size);
@@ -43,8 +44,12 @@ extern "C" void nsdl_reg_update();
 extern "C" void configure_endpoint();
 extern void NSP_registration();
 extern "C" void register_endpoint(bool init);
-extern void registration_update_thread(void const *args);
+extern void nsdl_registration_tick(void);
+extern void nsdl_registration_alive(void);
+extern void nsdl_registration_counts(uint32_t *registrations,uint32_t *updates);
 extern "C" void nsdl_set_nsp_address(void);
 extern "C" bool nsdl_endpoint_is_registered(void);
+extern bool nsdl_post_event(nsdl_event_handler_t handler,void *arg);
+extern uint32_t nsdl_dropped_events(void);
 
 #endif // __NSDL_SUPPORT_H__
@@ -1,28 +1,26 @@
 #ifndef __MOISTURE_RESOURCE_H__
 #define __MOISTURE_RESOURCE_H__
 // Base class
-#include "DynamicResource.h"
+#include "TypedResource.h"
 
 //Analog in moisture sensor
 AnalogIn moisture_in(A0);
 
 /** Moisture Resource **/
-class MoistureResource : public DynamicResource {
+class MoistureResource : public TypedResource<float> {
 public:
     /**
     Default constructor
     @param logger input logger instance for this resource
     @param name input the resource name
     @param observable input the resource is Observable (default: FALSE)
+    @param content_format input default content-format (default: text/plain, as read by the backend - TLV/CBOR via Accept)
     */
-    MoistureResource(const Logger *logger,const char *name,const bool observable = false) : DynamicResource(logger,name,"Moisture", SN_GRS_GET_ALLOWED,observable) {
+    MoistureResource(const Logger *logger,const char *name,const bool observable = false,const uint16_t content_format = CONTENT_FORMAT_TEXT_PLAIN) : TypedResource<float>(logger,name,"Moisture", SN_GRS_GET_ALLOWED,observable,content_format) {
     }
     
-    virtual string get() {
-        char moisture_lvl[7];
-        memset(moisture_lvl,0,7);
-        sprintf(moisture_lvl,"%3.2f", moisture_in.read());
-        return string(moisture_lvl);
+    virtual float read() {
+        return moisture_in.read();
     }
 };
 #endif
\ No newline at end of file
@@ -2,7 +2,7 @@
 #define __RELAY_RESOURCE_H__
 #include <ctime>
 // Base class
-#include "DynamicResource.h"
+#include "TypedResource.h"
 #include "mbed.h"
 
 //constants
@@ -17,31 +17,26 @@ static time_t lastQueried = 0;
 static Ticker queryChecker;
 
 /** Relay Resource **/
-class RelayResource : public DynamicResource {
+class RelayResource : public TypedResource<bool> {
 public:
     /**
     Default constructor
     @param logger input logger instance for this resource
     @param name input the resource name
     @param observable input the resource is Observable (default: FALSE)
+    @param content_format input default content-format (default: text/plain, as read by the backend - TLV/CBOR via Accept)
     */
-    RelayResource(const Logger *logger,const char *name,const bool observable = false) : DynamicResource(logger,name,"Relay", SN_GRS_GET_ALLOWED | SN_GRS_PUT_ALLOWED,observable) {
+    RelayResource(const Logger *logger,const char *name,const bool observable = false,const uint16_t content_format = CONTENT_FORMAT_TEXT_PLAIN) : TypedResource<bool>(logger,name,"Relay", SN_GRS_GET_ALLOWED | SN_GRS_PUT_ALLOWED,observable,content_format) {
         queryChecker.attach(this, &RelayResource::checkQueried, CHECK_INTERVAL);
     }
     
-    virtual string get() {
-        char relay_stat[2] = {0, 0};
-        relay_stat[0] = relay_state + '0';
+    virtual bool read() {
         lastQueried = time(NULL);
-        return string(relay_stat);
+        return (relay_state == 1);
     }
     
-    virtual void put(const string value) {
-        int newVal;
-        if (sscanf((char *)value.c_str(), "%d", &newVal) &&
-            (newVal == 0 || newVal == 1)) {
-            relay_out = relay_state = newVal;
-        }
+    virtual void write(const bool value) {
+        relay_out = relay_state = value ? 1 : 0;
         lastQueried = time(NULL);
     }
     